@@ -0,0 +1,205 @@
+/**
+ * Benchmarks of the main code paths on a synthetic table, see table_gen.hpp.
+ * Each one runs a few rounds and reports the best, in MB/s and entries/s.
+ *
+ * Usage: csfstuff_bench [options], see show_usage().
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/common.hpp"
+#include "../include/csf_reader.hpp"
+#include "../include/csf_writer.hpp"
+#include "../include/str_merge.hpp"
+#include "table_gen.hpp"
+
+using namespace std;
+
+void show_usage()
+{
+    cout << "Usage: csfstuff_bench [options]" << endl;
+    cout << endl;
+    cout << "    options:" << endl;
+    cout << "        --entries N: number of entries. Default is 100000." << endl;
+    cout << "        --mean-length L: mean string length in characters. Default is 40." << endl;
+    cout << "        --max-length L: longest string in characters. Default is 1000." << endl;
+    cout << "        --non-ascii R: fraction of non-ASCII strings. Default is 0.1." << endl;
+    cout << "        --extra R: fraction of entries with extra data. Default is 0.02." << endl;
+    cout << "        --seed S: tables are the same for the same seed. Default is 1." << endl;
+    cout << "        --rounds N: rounds per benchmark, the best one is reported. Default is 5." << endl;
+    cout << "        --write PREFIX: keep the table as PREFIX.str, PREFIX.csf and PREFIX.json (extra data)." << endl;
+}
+
+/**
+ * A fraction such as 0.05 as the nearest parts per million, the unit of TableGenOptions.
+ */
+uint32_t parts_per_million(const char *value)
+{
+    return (uint32_t) min(1000000.0, max(0.0, round(atof(value) * 1000000)));
+}
+
+/**
+ * Returns false on unknown options.
+ */
+bool parse_args(int argc, const char *argv[], TableGenOptions *options, int *rounds, string *prefix)
+{
+    for (int i = 1 ; i < argc ; i++)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (arg == "--entries")
+            options->num_entries = strtoull(value, nullptr, 10);
+        else if (arg == "--mean-length")
+            options->mean_length = strtoull(value, nullptr, 10);
+        else if (arg == "--max-length")
+            options->max_length = strtoull(value, nullptr, 10);
+        else if (arg == "--non-ascii")
+            options->non_ascii_ppm = parts_per_million(value);
+        else if (arg == "--extra")
+            options->extra_data_ppm = parts_per_million(value);
+        else if (arg == "--seed")
+            options->seed = strtoull(value, nullptr, 10);
+        else if (arg == "--rounds")
+            *rounds = max(1, atoi(value));
+        else if (arg == "--write")
+            *prefix = value;
+        else
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Best time of fn over rounds, in seconds.
+ */
+double best_time(int rounds, const function<void()> &fn)
+{
+    double best = 1e30;
+    for (int r = 0 ; r < rounds ; r++)
+    {
+        auto start = chrono::steady_clock::now();
+        fn();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void report(const char *what, double seconds, size_t bytes, size_t entries)
+{
+    printf("%-16s %9.1f MB/s %12.0f entries/s %9.2f ms\n",
+        what, bytes / seconds / 1e6, entries / seconds, seconds * 1e3);
+}
+
+/**
+ * STR text of entries, with the metadata entry that str2csf expects first.
+ */
+string make_str_text(const vector<Entry> &entries)
+{
+    string text;
+    append_entry_to_str(&text, "CSFSTUFF:META", "{\"lang_code\":0,\"unused\":0}", true);
+    for (const Entry &e: entries)
+        append_entry_to_str(&text, e.label, e.str, false);
+    return text;
+}
+
+/**
+ * Extra data as csf2str writes it. Generated labels and extra data need no escaping.
+ */
+string make_extra_data_json(const vector<Entry> &entries)
+{
+    string json = "{";
+    for (const Entry &e: entries)
+    {
+        if (e.extra_data.empty())
+            continue;
+        json += (json.length() > 1) ? ",\n" : "\n";
+        json += "  \"" + e.label + "\": \"" + e.extra_data + "\"";
+    }
+    json += "\n}";
+    return json;
+}
+
+int main(int argc, const char *argv[])
+{
+    TableGenOptions options;
+    int rounds = 5;
+    string prefix;
+    if (!parse_args(argc, argv, &options, &rounds, &prefix))
+    {
+        show_usage();
+        return 0;
+    }
+
+    const vector<Entry> entries = generate_table(options);
+    const string str_text = make_str_text(entries);
+
+    CSFHeader header;
+    header.num_labels = header.num_strings = entries.size();
+    header.unused = header.lang_code = 0;
+    const string csf_bytes = encode_csf(header, entries);
+
+    const string strfname = (prefix.empty() ? "csfstuff_bench" : prefix) + ".str";
+    write_file_atomic(strfname, str_text);
+    if (!prefix.empty())
+    {
+        write_file_atomic(prefix + ".csf", csf_bytes);
+        write_file_atomic(prefix + ".json", make_extra_data_json(entries));
+    }
+
+    printf("%zu entries, STR %.1f MB, CSF %.1f MB\n", entries.size(), str_text.length() / 1e6, csf_bytes.length() / 1e6);
+
+    size_t checksum = 0;
+    double seconds = best_time(rounds, [&]()
+    {
+        checksum += read_entries(strfname).size();
+    });
+    report("read_entries", seconds, str_text.length(), entries.size());
+
+    seconds = best_time(rounds, [&]()
+    {
+        checksum += scan_csf_entries(csf_bytes, header).size();
+    });
+    report("parse_entry", seconds, csf_bytes.length(), entries.size());
+
+    seconds = best_time(rounds, [&]()
+    {
+        checksum += encode_csf(header, entries).length();
+    });
+    report("encode_csf", seconds, csf_bytes.length(), entries.size());
+
+    // A base table and three overlays, each replacing every 7th string and adding some labels.
+    vector<string> overlay_texts;
+    for (uint64_t i = 0 ; i < 3 ; i++)
+        overlay_texts.push_back(make_str_text(generate_overlay(entries, 7, entries.size() / 50, options.seed + 1 + i)));
+    vector<vector<StrEntryView>> inputs = {parse_str_entries(str_text)};
+    size_t merge_bytes = str_text.length();
+    size_t merge_entries_count = inputs[0].size();
+    for (const string &text: overlay_texts)
+    {
+        inputs.push_back(parse_str_entries(text));
+        merge_bytes += text.length();
+        merge_entries_count += inputs.back().size();
+    }
+    seconds = best_time(rounds, [&]()
+    {
+        MergedEntries merged;
+        for (size_t i = 0 ; i < inputs.size() ; i++)
+            merge_entries(&merged, inputs[i], i);
+        checksum += merged.entries.size();
+    });
+    report("merge_entries", seconds, merge_bytes, merge_entries_count);
+
+    if (prefix.empty())
+        remove(strfname.c_str());
+
+    // Keeps the work above from being optimized away.
+    return checksum == 0 ? 1 : 0;
+}
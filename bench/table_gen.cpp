@@ -0,0 +1,164 @@
+/**
+ * Deterministic generator of synthetic string tables, for benchmarks.
+ * Only integer arithmetic is used, so the same options and seed mean the same table everywhere.
+ */
+#include "table_gen.hpp"
+
+using namespace std;
+
+/**
+ * splitmix64.
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed): state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) { return next() % n; }
+
+    /**
+     * True with probability ppm in a million.
+     */
+    bool chance(uint32_t ppm) { return below(1000000) < ppm; }
+
+private:
+    uint64_t state;
+};
+
+// Label categories of gamestrings.csf, most common first, repeated roughly by frequency.
+static const char *CATEGORIES[] = {
+    "DIALOGEVENT", "DIALOGEVENT", "DIALOGEVENT", "SUBTITLE", "SUBTITLE", "SUBTITLE",
+    "APT", "APT", "GUI", "GUI", "DESC", "NAME", "TOOLTIP", "SCRIPT", "MISSIONOBJ",
+    "CREDITS", "TYPE", "HOTKEYNAME", "HOTSPOT", "WOL", "STAT",
+};
+
+static const char *WORDS[] = {
+    "the", "allied", "soviet", "tank", "base", "power", "build", "unit", "attack", "move",
+    "commander", "mission", "objective", "destroy", "protect", "ore", "refinery", "barracks",
+    "select", "target", "%d", "%s", "credits", "ready", "construction", "complete", "enemy",
+};
+
+// Code point ranges for non-ASCII strings: Hangul, CJK, Cyrillic, and emoji outside the BMP.
+struct CodePointRange
+{
+    uint32_t first;
+    uint32_t count;
+};
+static const CodePointRange RANGES[] = {
+    {0xac00, 11172}, {0xac00, 11172}, {0x4e00, 20992}, {0x0410, 64}, {0x1f600, 80},
+};
+
+template <typename T, size_t N>
+size_t count_of(T (&)[N])
+{
+    return N;
+}
+
+void append_utf8(string *out, uint32_t cp)
+{
+    if (cp < 0x80)
+        out->push_back(cp);
+    else if (cp < 0x800)
+    {
+        out->push_back(0xc0 | (cp >> 6));
+        out->push_back(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        out->push_back(0xe0 | (cp >> 12));
+        out->push_back(0x80 | ((cp >> 6) & 0x3f));
+        out->push_back(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        out->push_back(0xf0 | (cp >> 18));
+        out->push_back(0x80 | ((cp >> 12) & 0x3f));
+        out->push_back(0x80 | ((cp >> 6) & 0x3f));
+        out->push_back(0x80 | (cp & 0x3f));
+    }
+}
+
+/**
+ * Geometric, so lengths are exponentially distributed around the mean.
+ */
+size_t random_length(Random *random, const TableGenOptions &options)
+{
+    const uint64_t stop = 1000000 / max<size_t>(1, options.mean_length);
+    size_t length = 0;
+    while (length < options.max_length && random->below(1000000) >= stop)
+        length++;
+    return length;
+}
+
+string random_string(Random *random, const TableGenOptions &options)
+{
+    const size_t length = random_length(random, options);
+    string result;
+    if (random->chance(options.non_ascii_ppm))
+    {
+        const CodePointRange &range = RANGES[random->below(count_of(RANGES))];
+        for (size_t i = 0 ; i < length ; i++)
+            append_utf8(&result, random->chance(150000) ? ' ' : range.first + random->below(range.count));
+        return result;
+    }
+
+    while (result.length() < length)
+    {
+        if (!result.empty())
+            result += random->chance(20000) ? '\n' : ' ';
+        result += WORDS[random->below(count_of(WORDS))];
+    }
+    return result;
+}
+
+Entry random_entry(Random *random, const TableGenOptions &options, size_t number)
+{
+    Entry e;
+    e.label = CATEGORIES[random->below(count_of(CATEGORIES))];
+    e.label += ':';
+    e.label += WORDS[random->below(count_of(WORDS))];
+    e.label += to_string(number); // keeps labels unique.
+    e.str = random_string(random, options);
+    if (random->chance(options.extra_data_ppm))
+    {
+        for (int i = 0 ; i < 8 ; i++)
+            e.extra_data.push_back('a' + random->below(26));
+    }
+    return e;
+}
+
+vector<Entry> generate_table(const TableGenOptions &options)
+{
+    Random random(options.seed);
+    vector<Entry> result;
+    result.reserve(options.num_entries);
+    for (size_t i = 0 ; i < options.num_entries ; i++)
+        result.push_back(random_entry(&random, options, i));
+    return result;
+}
+
+vector<Entry> generate_overlay(const vector<Entry> &table, size_t step, size_t num_new_entries, uint64_t seed)
+{
+    TableGenOptions options;
+    options.seed = seed;
+    Random random(seed);
+
+    vector<Entry> result;
+    for (size_t i = 0 ; i < table.size() ; i += max<size_t>(1, step))
+    {
+        Entry e = table[i];
+        e.str = random_string(&random, options);
+        result.push_back(e);
+    }
+    for (size_t i = 0 ; i < num_new_entries ; i++)
+        result.push_back(random_entry(&random, options, table.size() + i));
+    return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/common.hpp"
+
+/**
+ * Shape of a synthetic string table. The defaults look like samples/gamestrings.csf:
+ * labels such as DIALOGEVENT:..., SUBTITLE:..., GUI:..., and strings of about 40 bytes
+ * with a long tail.
+ */
+struct TableGenOptions
+{
+    size_t num_entries = 100000;
+    size_t mean_length = 40; // characters per string, exponentially distributed.
+    size_t max_length = 1000;
+    uint32_t non_ascii_ppm = 100000; // strings made of non-ASCII characters, per million.
+    uint32_t extra_data_ppm = 20000; // entries with extra data, per million.
+    uint64_t seed = 1;
+};
+
+/**
+ * Same options give the same table, on any platform.
+ * Labels are unique, and entries are preceded by no metadata entry.
+ */
+std::vector<Entry> generate_table(const TableGenOptions &options);
+
+/**
+ * An overlay for table: every step-th label gets a new string, and num_new_entries new labels are added.
+ */
+std::vector<Entry> generate_overlay(const std::vector<Entry> &table, size_t step, size_t num_new_entries, uint64_t seed);
@@ -0,0 +1,155 @@
+/**
+ * Micro-benchmark of the flipped UTF-16 <-> UTF-8 kernels.
+ * Decodes and encodes every string of the given CSF files with the old wstring_convert
+ * based code and with each SIMD level the CPU supports.
+ *
+ * Usage: utf16_bench file1.csf file2.csf ...
+ */
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// The reference implementation is what csf2str used before, deprecated as it is.
+#include <locale>
+#include <codecvt>
+
+#include "../include/csf_reader.hpp"
+#include "../include/utf16.hpp"
+
+using namespace std;
+
+string read_flipped_utf16_codecvt(const char *p, size_t n)
+{
+    // Flip bits
+    u16string tmp(n, '\0');
+    memcpy(&tmp[0], p, 2 * n);
+    for (size_t i = 0 ; i < n ; i++)
+        tmp[i] = ~tmp[i];
+
+    wstring_convert<codecvt_utf8_utf16<char16_t>, char16_t> cv;
+    return cv.to_bytes(tmp);
+}
+
+u16string write_flipped_utf16_codecvt(const string &s)
+{
+    wstring_convert<codecvt_utf8_utf16<char16_t>, char16_t> cv;
+    u16string tmp = cv.from_bytes(s);
+
+    // Flip bits
+    for (size_t i = 0 ; i < tmp.length() ; i++)
+        tmp[i] = ~(tmp[i]);
+    return tmp;
+}
+
+u16string write_flipped_utf16_simd(const string &s, SimdLevel level)
+{
+    u16string result(s.length(), u'\0');
+    size_t error_offset;
+    result.resize(utf8_to_flipped_utf16(s, (char *) &result[0], &error_offset, level));
+    return result;
+}
+
+/**
+ * Encode all strings `rounds` times, returns MB/s of UTF-16 output.
+ */
+template <typename Encoder>
+double measure_encode(const vector<string> &strings, int rounds, Encoder encode, size_t *checksum)
+{
+    size_t bytes = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0 ; r < rounds ; r++)
+    {
+        for (const string &s: strings)
+        {
+            u16string u = encode(s);
+            *checksum += u.length();
+            bytes += 2 * u.length();
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return bytes / seconds / 1e6;
+}
+
+/**
+ * Decode all strings of csf `rounds` times, returns MB/s of UTF-16 input.
+ */
+template <typename Decoder>
+double measure(const CsfFile &csf, int rounds, Decoder decode, size_t *checksum)
+{
+    size_t bytes = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0 ; r < rounds ; r++)
+    {
+        for (const CsfEntryRef &ref: csf.entries)
+        {
+            string s = decode(csf.file.data() + ref.str_offset, ref.str_length);
+            *checksum += s.length() + (s.empty() ? 0 : (unsigned char) s.back());
+            bytes += 2 * ref.str_length;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return bytes / seconds / 1e6;
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: utf16_bench file1.csf file2.csf ..." << endl;
+        return 0;
+    }
+
+    const int rounds = 20;
+    vector<SimdLevel> levels = {SimdLevel::SCALAR};
+    if (detect_simd_level() >= SimdLevel::SSE41)
+        levels.push_back(SimdLevel::SSE41);
+    if (detect_simd_level() >= SimdLevel::AVX2)
+        levels.push_back(SimdLevel::AVX2);
+
+    for (int i = 1 ; i < argc ; i++)
+    {
+        CsfFile csf(argv[i]);
+
+        // Every level must agree with the reference implementation.
+        vector<string> strings;
+        for (size_t j = 0 ; j < csf.entries.size() ; j++)
+        {
+            const CsfEntryRef &ref = csf.entries[j];
+            const char *p = csf.file.data() + ref.str_offset;
+            string expected = read_flipped_utf16_codecvt(p, ref.str_length);
+            u16string flipped = write_flipped_utf16_codecvt(expected);
+            for (SimdLevel level: levels)
+            {
+                ASSERT(flipped_utf16_to_utf8(p, ref.str_length, level) == expected,
+                    "Decoder mismatch at label " << csf.label(j) << " with " << simd_level_name(level));
+                ASSERT(write_flipped_utf16_simd(expected, level) == flipped,
+                    "Encoder mismatch at label " << csf.label(j) << " with " << simd_level_name(level));
+            }
+            strings.push_back(expected);
+        }
+
+        cout << argv[i] << " (" << csf.entries.size() << " strings)" << endl;
+        size_t checksum = 0;
+        double baseline = measure(csf, rounds, read_flipped_utf16_codecvt, &checksum);
+        printf("    decode %-10s %8.1f MB/s\n", "codecvt", baseline);
+        for (SimdLevel level: levels)
+        {
+            auto decode = [level](const char *p, size_t n) { return flipped_utf16_to_utf8(p, n, level); };
+            double speed = measure(csf, rounds, decode, &checksum);
+            printf("    decode %-10s %8.1f MB/s  (x%.1f)\n", simd_level_name(level), speed, speed / baseline);
+        }
+
+        baseline = measure_encode(strings, rounds, write_flipped_utf16_codecvt, &checksum);
+        printf("    encode %-10s %8.1f MB/s\n", "codecvt", baseline);
+        for (SimdLevel level: levels)
+        {
+            auto encode = [level](const string &s) { return write_flipped_utf16_simd(s, level); };
+            double speed = measure_encode(strings, rounds, encode, &checksum);
+            printf("    encode %-10s %8.1f MB/s  (x%.1f)\n", simd_level_name(level), speed, speed / baseline);
+        }
+        if (checksum == 0)
+            cout << "    (no strings)" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csf2str.dir/csf2str.cpp.o"
+  "CMakeFiles/csf2str.dir/csf2str.cpp.o.d"
+  "csf2str"
+  "csf2str.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csf2str.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
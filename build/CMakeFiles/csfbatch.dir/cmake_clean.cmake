@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csfbatch.dir/csfbatch.cpp.o"
+  "CMakeFiles/csfbatch.dir/csfbatch.cpp.o.d"
+  "csfbatch"
+  "csfbatch.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csfbatch.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csfquery.dir/csfquery.cpp.o"
+  "CMakeFiles/csfquery.dir/csfquery.cpp.o.d"
+  "csfquery"
+  "csfquery.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csfquery.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
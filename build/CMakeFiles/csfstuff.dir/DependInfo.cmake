@@ -0,0 +1,28 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/common.cpp" "CMakeFiles/csfstuff.dir/common.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/common.cpp.o.d"
+  "/root/repo/csf_index.cpp" "CMakeFiles/csfstuff.dir/csf_index.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/csf_index.cpp.o.d"
+  "/root/repo/csf_reader.cpp" "CMakeFiles/csfstuff.dir/csf_reader.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/csf_reader.cpp.o.d"
+  "/root/repo/csf_writer.cpp" "CMakeFiles/csfstuff.dir/csf_writer.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/csf_writer.cpp.o.d"
+  "/root/repo/csfstuff.cpp" "CMakeFiles/csfstuff.dir/csfstuff.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/csfstuff.cpp.o.d"
+  "/root/repo/file_io.cpp" "CMakeFiles/csfstuff.dir/file_io.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/file_io.cpp.o.d"
+  "/root/repo/label_index.cpp" "CMakeFiles/csfstuff.dir/label_index.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/label_index.cpp.o.d"
+  "/root/repo/str_cache.cpp" "CMakeFiles/csfstuff.dir/str_cache.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/str_cache.cpp.o.d"
+  "/root/repo/str_merge.cpp" "CMakeFiles/csfstuff.dir/str_merge.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/str_merge.cpp.o.d"
+  "/root/repo/utf16.cpp" "CMakeFiles/csfstuff.dir/utf16.cpp.o" "gcc" "CMakeFiles/csfstuff.dir/utf16.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,29 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csfstuff.dir/common.cpp.o"
+  "CMakeFiles/csfstuff.dir/common.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/csf_index.cpp.o"
+  "CMakeFiles/csfstuff.dir/csf_index.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/csf_reader.cpp.o"
+  "CMakeFiles/csfstuff.dir/csf_reader.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/csf_writer.cpp.o"
+  "CMakeFiles/csfstuff.dir/csf_writer.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/csfstuff.cpp.o"
+  "CMakeFiles/csfstuff.dir/csfstuff.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/file_io.cpp.o"
+  "CMakeFiles/csfstuff.dir/file_io.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/label_index.cpp.o"
+  "CMakeFiles/csfstuff.dir/label_index.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/str_cache.cpp.o"
+  "CMakeFiles/csfstuff.dir/str_cache.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/str_merge.cpp.o"
+  "CMakeFiles/csfstuff.dir/str_merge.cpp.o.d"
+  "CMakeFiles/csfstuff.dir/utf16.cpp.o"
+  "CMakeFiles/csfstuff.dir/utf16.cpp.o.d"
+  "libcsfstuff.a"
+  "libcsfstuff.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csfstuff.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
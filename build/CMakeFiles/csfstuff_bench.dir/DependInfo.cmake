@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/bench/csfstuff_bench.cpp" "CMakeFiles/csfstuff_bench.dir/bench/csfstuff_bench.cpp.o" "gcc" "CMakeFiles/csfstuff_bench.dir/bench/csfstuff_bench.cpp.o.d"
+  "/root/repo/bench/table_gen.cpp" "CMakeFiles/csfstuff_bench.dir/bench/table_gen.cpp.o" "gcc" "CMakeFiles/csfstuff_bench.dir/bench/table_gen.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/build/CMakeFiles/csfstuff.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csfstuff_bench.dir/bench/csfstuff_bench.cpp.o"
+  "CMakeFiles/csfstuff_bench.dir/bench/csfstuff_bench.cpp.o.d"
+  "CMakeFiles/csfstuff_bench.dir/bench/table_gen.cpp.o"
+  "CMakeFiles/csfstuff_bench.dir/bench/table_gen.cpp.o.d"
+  "csfstuff_bench"
+  "csfstuff_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csfstuff_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
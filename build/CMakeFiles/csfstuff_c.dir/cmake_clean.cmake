@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csfstuff_c.dir/csfstuff_c.cpp.o"
+  "CMakeFiles/csfstuff_c.dir/csfstuff_c.cpp.o.d"
+  "libcsfstuff_c.pdb"
+  "libcsfstuff_c.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csfstuff_c.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
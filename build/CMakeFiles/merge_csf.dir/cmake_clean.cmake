@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/merge_csf.dir/merge_csf.cpp.o"
+  "CMakeFiles/merge_csf.dir/merge_csf.cpp.o.d"
+  "merge_csf"
+  "merge_csf.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/merge_csf.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
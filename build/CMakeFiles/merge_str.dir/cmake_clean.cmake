@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/merge_str.dir/merge_str.cpp.o"
+  "CMakeFiles/merge_str.dir/merge_str.cpp.o.d"
+  "merge_str"
+  "merge_str.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/merge_str.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
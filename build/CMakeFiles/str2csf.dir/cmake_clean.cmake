@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/str2csf.dir/str2csf.cpp.o"
+  "CMakeFiles/str2csf.dir/str2csf.cpp.o.d"
+  "str2csf"
+  "str2csf.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/str2csf.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
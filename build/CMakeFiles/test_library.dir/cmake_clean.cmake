@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_library.dir/tests/test_library.cpp.o"
+  "CMakeFiles/test_library.dir/tests/test_library.cpp.o.d"
+  "test_library"
+  "test_library.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_library.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/utf16_bench.dir/bench/utf16_bench.cpp.o"
+  "CMakeFiles/utf16_bench.dir/bench/utf16_bench.cpp.o.d"
+  "utf16_bench"
+  "utf16_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utf16_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
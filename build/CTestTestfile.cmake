@@ -0,0 +1,12 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(allocations "/root/repo/build/test_allocations")
+set_tests_properties(allocations PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;40;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(library "/root/repo/build/test_library")
+set_tests_properties(library PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;43;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(bench_smoke "/root/repo/build/csfstuff_bench" "--entries" "2000" "--rounds" "1")
+set_tests_properties(bench_smoke PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;44;add_test;/root/repo/CMakeLists.txt;0;")
@@ -1,49 +1,65 @@
-#include <fstream>
 #include <vector>
 #include <cctype>
-#include <regex>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
 #include "include/common.hpp"
 
 using namespace std;
 
-bool file_exists(const string &fname)
+void append_escaped_char(string *result, char ch)
 {
-    std::ifstream infile(fname);
-    return infile.good();
+    switch (ch)
+    {
+        case '\n':
+            *result += "\\n";
+            break;
+        case '\\':
+            *result += "\\\\";
+            break;
+        case '"':
+            *result += "\\\"";
+            break;
+        default:
+            *result += ch;
+    }
 }
 
-string escape_characters(const string &s)
+/**
+ * Append s to result, quoted and escaped.
+ */
+void append_escaped(string *result, string_view s)
 {
-    string result = "\"";
-
+    *result += '"';
     for (char ch: s)
+        append_escaped_char(result, ch);
+    *result += '"';
+}
+
+bool has_valid_escapes(string_view s)
+{
+    for (size_t i = 0 ; i < s.length() ; i++)
     {
-        switch (ch)
-        {
-            case '\n':
-                result += "\\n";
-                break;
-            case '\\':
-                result += "\\\\";
-                break;
-            case '"':
-                result += "\\\"";
-                break;
-            default:
-                result += ch;
-        }
+        if (s[i] != '\\')
+            continue;
+        i++;
+        if (i < s.length() && s[i] != 'n' && s[i] != '\\' && s[i] != '"')
+            return false;
     }
-
-    result += "\"";
-    return result;
+    return true;
 }
 
-string unescape_characters(const string &s)
+/**
+ * Unescape s, handing each resulting character to emit.
+ */
+template <typename Emit>
+void unescape_each(string_view s, Emit emit)
 {
     enum mode_t { NORMAL, ESCAPED };
 
     mode_t mode = NORMAL;
-    string result;
 
     for (char ch: s)
     {
@@ -52,20 +68,20 @@ string unescape_characters(const string &s)
             if (ch == '\\')
                 mode = ESCAPED;
             else
-                result += ch;
+                emit(ch);
         }
         else
         {
             switch (ch)
             {
                 case 'n':
-                    result += '\n';
+                    emit('\n');
                     break;
                 case '\\':
-                    result += '\\';
+                    emit('\\');
                     break;
                 case '"':
-                    result += '"';
+                    emit('"');
                     break;
                 default:
                     ASSERT(0, "Invalid character! Got '" << ch << "': " << s);
@@ -74,76 +90,423 @@ string unescape_characters(const string &s)
             mode = NORMAL;
         }
     }
+}
 
+string unescape_characters(string_view s)
+{
+    // Unescaping never makes a string longer, so this is the only allocation.
+    string result;
+    result.reserve(s.length());
+    unescape_each(s, [&result](char ch) { result += ch; });
     return result;
 }
 
+/**
+ * Append one STR entry to out. Entries are separated by a blank line,
+ * so every entry but the first in a file gets one in front.
+ */
+void append_entry_to_str(string *out, string_view label, string_view str, bool is_first)
+{
+    if (!is_first)
+        *out += '\n';
+
+    *out += label;
+    *out += '\n';
+    append_escaped(out, str);
+    *out += "\nEND\n";
+}
+
+/**
+ * Same as above, but the string is unescaped and escaped again on the fly
+ * rather than through a temporary string.
+ */
+void append_entry_to_str(string *out, const StrEntryView &entry, bool is_first)
+{
+    if (!is_first)
+        *out += '\n';
+
+    *out += entry.label;
+    *out += "\n\"";
+    unescape_each(entry.raw_str, [out](char ch) { append_escaped_char(out, ch); });
+    *out += "\"\nEND\n";
+}
+
 void write_entry_to_str(FILE *fp, const Entry &entry)
 {
     static bool is_first = true;
 
-    if (!is_first)
+    string buffer;
+    append_entry_to_str(&buffer, entry.label, entry.str, is_first);
+    is_first = false;
+
+    fwrite(buffer.data(), sizeof(char), buffer.length(), fp);
+}
+
+/**
+ * Same character class as \s of std::regex in the "C" locale.
+ */
+bool is_space(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+/**
+ * "." of std::regex (ECMAScript) matches anything but these.
+ */
+bool is_line_terminator(char ch)
+{
+    return ch == '\n' || ch == '\r';
+}
+
+/**
+ * Shape of a STR line, found by a single pass over its bytes.
+ * Everything the STR grammar cares about can be told from these three positions,
+ * which used to be done by running several regular expressions on each line.
+ *
+ * first: index of the first non-whitespace character, or len if there is none.
+ * last: index of the last non-whitespace character, or len if there is none.
+ * eol: index of the first \r or \n at or after first, or len if there is none.
+ */
+struct LineShape
+{
+    size_t first;
+    size_t last;
+    size_t eol;
+};
+
+LineShape scan_line(string_view line)
+{
+    const size_t len = line.length();
+    LineShape shape = {len, len, len};
+
+    enum state_t { LEADING_SPACE, BODY };
+    state_t state = LEADING_SPACE;
+    for (size_t i = 0 ; i < len ; i++)
     {
-        fprintf(fp, "\n");
+        const char ch = line[i];
+        switch (state)
+        {
+            case LEADING_SPACE:
+                if (is_space(ch))
+                    break;
+                shape.first = i;
+                shape.last = i;
+                state = BODY;
+                break;
+            case BODY:
+                if (!is_space(ch))
+                    shape.last = i;
+                else if (is_line_terminator(ch) && shape.eol == len)
+                    shape.eol = i;
+                break;
+        }
     }
-    is_first = false;
 
-    fprintf(fp, "%s\n", entry.label.c_str());
-    fprintf(fp, "%s\n", escape_characters(entry.str).c_str());
-    fprintf(fp, "END\n");
+    return shape;
+}
+
+bool starts_with_at(string_view line, size_t pos, string_view prefix)
+{
+    return line.substr(pos, prefix.length()) == prefix;
 }
 
 /**
  * Match whitespace and/or comment.
  * "" returns true.
  */
-bool is_whitespace_or_comment(const string &line)
+bool is_whitespace_or_comment(string_view line, const LineShape &shape)
 {
-    // matches whitespace and an optional //-comment
-    const static regex expr("\\s*(//.*)?");
-    smatch _match;
-    return regex_match(line, _match, expr);
+    if (shape.first == line.length())
+        return true;
+    // A //-comment runs to the end of the line but can't contain line terminators.
+    return starts_with_at(line, shape.first, "//") && shape.eol == line.length();
 }
 
-bool is_END(const string &line)
+bool is_whitespace_or_comment_from(string_view line, size_t pos)
 {
-    // Matches END, which may or may not be surrounded by white spaces.
-    const static regex expr("\\s*END(.*)");
-    smatch match;
-    bool is_match = regex_match(line, match, expr);
-    if (!is_match)
+    while (pos < line.length() && is_space(line[pos]))
+        pos++;
+    return pos == line.length() || starts_with_at(line, pos, "//");
+}
+
+/**
+ * Matches END, which may or may not be surrounded by white spaces.
+ * Anything after END must be whitespace or a comment.
+ */
+bool is_END(string_view line, const LineShape &shape)
+{
+    if (!starts_with_at(line, shape.first, "END"))
+        return false;
+    if (shape.eol != line.length())
         return false;
-    //for (unsigned i=0; i<match.size(); ++i)
-    //    std::cout << "match #" << i << ": " << match[i] << std::endl;
-    string after_end = match[1].str();
-    return is_whitespace_or_comment(after_end);
+    return is_whitespace_or_comment_from(line, shape.first + 3);
 }
 
-string strip_str(const int lineno, const string &line)
+/**
+ * Strips the quoted block, which may or may not be surrounded by white spaces.
+ */
+bool strip_str(string_view line, const LineShape &shape, string_view *result)
 {
-    // Matches quoted block, which may or may not be surrounded by white spaces.
-    const static regex expr("\\s*\"(.*)\"\\s*");
-    smatch match;
-    bool is_match = regex_match(line, match, expr);
-    ASSERT(is_match, "\nline " << lineno << ": \"" << line << "\" is not a proper in-game string. It must not be commented and properly quoted at the start and at the end.");
-    //for (unsigned i=0; i<match.size(); ++i)
-    //    std::cout << "match #" << i << ": " << match[i] << std::endl;
-    return match[1].str();
+    const bool is_match = shape.first < line.length()
+        && line[shape.first] == '"'
+        && shape.last > shape.first
+        && line[shape.last] == '"'
+        && shape.eol > shape.last;
+    if (is_match)
+        *result = line.substr(shape.first + 1, shape.last - shape.first - 1);
+    return is_match;
 }
 
-string strip_label(const int lineno, const string &line)
+/**
+ * Leading white spaces are stripped but trailing ones are kept,
+ * unless they are separated from the label by a line terminator.
+ */
+bool strip_label(string_view line, const LineShape &shape, string_view *result)
 {
-    const static regex expr("\\s*(.+)\\s*");
-    smatch match;
-    bool is_match = regex_match(line, match, expr);
-    ASSERT(is_match, "\nline " << lineno << ": \"" << line << "\" label must not have comment part.");
-    //for (unsigned i=0; i<match.size(); ++i)
-    //    std::cout << "match #" << i << ": " << match[i] << std::endl;
-    return match[1].str();
+    const bool is_match = shape.first < line.length()
+        && (shape.eol == line.length() || shape.last < shape.eol);
+    if (is_match)
+        *result = line.substr(shape.first, shape.eol - shape.first);
+    return is_match;
 }
 
 /**
- * Read entries from str files.
+ * First error found while parsing a range of a STR file.
+ * Kept aside rather than asserted right away, because a range parsed
+ * speculatively by parse_str_entries() may turn out to be thrown away.
+ */
+struct StrParseError
+{
+    enum kind_t { NONE, BAD_LABEL, BAD_STR, NO_END };
+    kind_t kind = NONE;
+    int lineno = 0;
+    string_view line;
+};
+
+/**
+ * Entries of text[begin, end).
+ * Line numbers are relative to begin until the range is placed in the file.
+ */
+struct StrRange
+{
+    size_t begin = 0;
+    size_t end = 0;
+    int num_lines = 0;
+    vector<StrEntryView> entries;
+    StrParseError error;
+};
+
+/**
+ * The STR grammar, fed one line at a time.
+ * Shared by the in-memory parser and StrStreamReader.
+ */
+class StrLineParser
+{
+public:
+    enum event_t { SKIPPED, LABEL, STR, END };
+    enum state_t { SEEK_AND_READ_LABEL, READ_STR, READ_END };
+    state_t state = SEEK_AND_READ_LABEL;
+    StrParseError error;
+
+    /**
+     * *part receives the label or the quoted string on LABEL and STR events.
+     * It is empty if the line is malformed, in which case the first such line is kept in error.
+     */
+    event_t feed(string_view line, int lineno, string_view *part)
+    {
+        const LineShape shape = scan_line(line);
+        *part = string_view();
+        switch (state)
+        {
+            case SEEK_AND_READ_LABEL:
+                if (is_whitespace_or_comment(line, shape))
+                    return SKIPPED;
+                if (!strip_label(line, shape, part))
+                    fail(StrParseError::BAD_LABEL, lineno, line);
+                state = READ_STR;
+                return LABEL;
+            case READ_STR:
+                if (!strip_str(line, shape, part))
+                    fail(StrParseError::BAD_STR, lineno, line);
+                state = READ_END;
+                return STR;
+            case READ_END:
+                if (!is_END(line, shape))
+                    fail(StrParseError::NO_END, lineno, line);
+                state = SEEK_AND_READ_LABEL;
+                return END;
+            default:
+                ASSERT(0, "Can't reach here");
+                return SKIPPED;
+        }
+    }
+
+private:
+    void fail(StrParseError::kind_t kind, int lineno, string_view line)
+    {
+        if (error.kind != StrParseError::NONE)
+            return;
+        error.kind = kind;
+        error.lineno = lineno;
+        error.line = line;
+    }
+};
+
+/**
+ * Parse lines from text[begin], which must be the start of a line outside of any entry.
+ * Stops at the first line start at or after stop that is outside of any entry again,
+ * or at the end of text. Any trailing incomplete entry is dropped.
+ */
+StrRange parse_str_range(string_view text, size_t begin, size_t stop)
+{
+    StrRange result;
+    result.begin = begin;
+    StrEntryView entry;
+    StrLineParser parser;
+
+    int lineno = 0;
+    size_t pos = begin;
+    while (pos < text.length())
+    {
+        if (parser.state == StrLineParser::SEEK_AND_READ_LABEL && pos >= stop)
+            break;
+
+        size_t newline = text.find('\n', pos);
+        if (newline == string_view::npos)
+            newline = text.length();
+        const string_view line = text.substr(pos, newline - pos);
+        pos = min(newline + 1, text.length());
+        lineno++;
+
+        string_view part;
+        switch (parser.feed(line, lineno, &part))
+        {
+            case StrLineParser::SKIPPED:
+                break;
+            case StrLineParser::LABEL:
+                entry.label = part;
+                entry.lineno = lineno;
+                break;
+            case StrLineParser::STR:
+                entry.raw_str = part;
+                break;
+            case StrLineParser::END:
+                result.entries.push_back(entry);
+                entry = StrEntryView();
+                break;
+        }
+    }
+
+    result.end = pos;
+    result.num_lines = lineno;
+    result.error = parser.error;
+    return result;
+}
+
+/**
+ * What report_error asserts with, empty if there is no error.
+ */
+string describe_error(const StrParseError &error)
+{
+    ostringstream message;
+    switch (error.kind)
+    {
+        case StrParseError::NONE:
+            break;
+        case StrParseError::BAD_LABEL:
+            message << "\nline " << error.lineno << ": \"" << error.line << "\" label must not have comment part.";
+            break;
+        case StrParseError::BAD_STR:
+            message << "\nline " << error.lineno << ": \"" << error.line << "\" is not a proper in-game string. It must not be commented and properly quoted at the start and at the end.";
+            break;
+        case StrParseError::NO_END:
+            message << "\nSTR file line " << error.lineno << ": END expected, got \"" << error.line << "\", invalid input!";
+            break;
+    }
+    return message.str();
+}
+
+void report_error(const StrParseError &error)
+{
+    ASSERT(error.kind == StrParseError::NONE, describe_error(error));
+}
+
+/**
+ * Guess where an entry boundary is: the start of the line after the first END at or after pos.
+ * pos is moved to a line start first. The guess is checked later, see parse_str_entries().
+ */
+size_t resync(string_view text, size_t pos)
+{
+    if (pos > 0)
+    {
+        pos = text.find('\n', pos - 1);
+        pos = (pos == string_view::npos) ? text.length() : pos + 1;
+    }
+
+    while (pos < text.length())
+    {
+        size_t newline = text.find('\n', pos);
+        if (newline == string_view::npos)
+            newline = text.length();
+        const string_view line = text.substr(pos, newline - pos);
+        pos = min(newline + 1, text.length());
+
+        if (is_END(line, scan_line(line)))
+            break;
+    }
+    return pos;
+}
+
+/**
+ * parse_str_entries, with the first error kept in *error instead of reported.
+ */
+vector<StrEntryView> parse_str_entries(string_view text, int num_threads, StrParseError *error)
+{
+    // Not worth the threads below this size per range.
+    const size_t min_range_size = 256 * 1024;
+    const size_t num_ranges = max<size_t>(1, min<size_t>(num_threads, text.length() / min_range_size));
+
+    vector<size_t> starts(num_ranges + 1);
+    starts[0] = 0;
+    starts[num_ranges] = text.length();
+    for (size_t i = 1 ; i < num_ranges ; i++)
+        starts[i] = max(starts[i - 1], resync(text, i * (text.length() / num_ranges)));
+
+    vector<StrRange> ranges(num_ranges);
+    parallel_for(num_ranges, num_threads, [&](size_t i)
+    {
+        ranges[i] = parse_str_range(text, starts[i], starts[i + 1]);
+    });
+
+    vector<StrEntryView> result;
+    size_t pos = 0;
+    int lineno = 0;
+    for (size_t i = 0 ; i < num_ranges ; i++)
+    {
+        // If the previous range ran over this one entirely, this yields an empty range.
+        if (ranges[i].begin != pos)
+            ranges[i] = parse_str_range(text, pos, starts[i + 1]);
+
+        StrRange &range = ranges[i];
+        for (StrEntryView &entry: range.entries)
+            entry.lineno += lineno;
+        result.insert(result.end(), range.entries.begin(), range.entries.end());
+
+        if (range.error.kind != StrParseError::NONE && error->kind == StrParseError::NONE)
+        {
+            *error = range.error;
+            error->lineno += lineno;
+        }
+
+        pos = range.end;
+        lineno += range.num_lines;
+    }
+
+    return result;
+}
+
+/**
+ * Read entries from the text of a str file.
  * STR files look like this:
  *
  * TXT_POWER_DRAIN
@@ -153,46 +516,363 @@ string strip_label(const int lineno, const string &line)
  * TXT_STAND_BY
  * "Please Stand By..."
  * END
+ *
+ * Lines are split at \n only, like getline does.
+ * The returned views point into text.
+ *
+ * With more than one thread, text is cut into byte ranges which are moved to the next
+ * END line and parsed concurrently. Each range is then checked to begin exactly where
+ * the previous one stopped. If a guess was wrong (say, a label named END),
+ * that range is parsed again from where the previous one stopped,
+ * so the result is always the same as a sequential parse.
  */
-std::vector<Entry> read_entries(const std::string &fname)
+vector<StrEntryView> parse_str_entries(string_view text, int num_threads)
 {
-    vector<Entry> result;
-    Entry entry;
+    StrParseError error;
+    vector<StrEntryView> result = parse_str_entries(text, num_threads, &error);
+    report_error(error);
+    return result;
+}
 
-    ASSERT(file_exists(fname), fname << " does not exists!");
-    ifstream fs(fname);
-    string line;
+bool try_parse_str_entries(string_view text, int num_threads, vector<StrEntryView> *entries, string *error)
+{
+    StrParseError parse_error;
+    *entries = parse_str_entries(text, num_threads, &parse_error);
+    if (parse_error.kind == StrParseError::NONE)
+        return true;
+    if (error != nullptr)
+        *error = describe_error(parse_error);
+    return false;
+}
 
-    enum state_t { SEEK_AND_READ_LABEL, READ_STR, READ_END };
-    state_t state = SEEK_AND_READ_LABEL;
-    int lineno = 1;
-    while (getline(fs, line))
+size_t parse_str_block
+(
+    string_view text, int first_lineno, bool last_block,
+    vector<StrEntryView> *entries, int *num_lines, string *error
+)
+{
+    StrLineParser parser;
+    StrEntryView entry;
+    size_t consumed = 0; // end of the last line outside of any entry
+    int consumed_lines = 0;
+
+    int lineno = 0;
+    size_t pos = 0;
+    while (pos < text.length())
     {
-        switch (state)
+        size_t newline = text.find('\n', pos);
+        if (newline == string_view::npos)
+            newline = text.length();
+        const string_view line = text.substr(pos, newline - pos);
+        pos = min(newline + 1, text.length());
+        lineno++;
+
+        string_view part;
+        switch (parser.feed(line, first_lineno + lineno, &part))
         {
-            case SEEK_AND_READ_LABEL:
-                if (is_whitespace_or_comment(line))
-                    continue;
-                entry.label = strip_label(lineno, line);
-                state = READ_STR;
+            case StrLineParser::SKIPPED:
                 break;
-            case READ_STR:
-                entry.str = unescape_characters( strip_str(lineno, line) );
-                state = READ_END;
+            case StrLineParser::LABEL:
+                entry.label = part;
+                entry.lineno = first_lineno + lineno;
                 break;
-            case READ_END:
-                ASSERT(is_END(line), "\nSTR file line " << lineno << ": END expected, got \"" + line + "\", invalid input!");
-                state = SEEK_AND_READ_LABEL;
-                // cout << entry.label << " " << entry.str << endl;
-                result.push_back(entry);
+            case StrLineParser::STR:
+                entry.raw_str = part;
                 break;
-            default:
-                ASSERT(0, "Can't reach here");
+            case StrLineParser::END:
+                entries->push_back(entry);
+                entry = StrEntryView();
                 break;
         }
+        if (parser.state == StrLineParser::SEEK_AND_READ_LABEL)
+        {
+            consumed = pos;
+            consumed_lines = lineno;
+        }
+    }
+
+    // Lines of the open entry are parsed again with the next block, and reported then.
+    // The last block has no next one.
+    if (last_block || parser.error.lineno <= first_lineno + consumed_lines)
+        *error = describe_error(parser.error);
+    *num_lines = consumed_lines;
+    return consumed;
+}
+
+StrFile::StrFile(const string &fname, int num_threads):
+    file(fname),
+    entries(parse_str_entries(file.view(), num_threads))
+{
+}
+
+StrStreamReader::StrStreamReader(const string &fname):
+    file(fname, ios::binary)
+{
+    ASSERT(file.is_open(), "Failed to open " << fname);
+}
+
+bool StrStreamReader::next(StrEntryView *entry)
+{
+    StrLineParser parser;
+    string_view part;
+    while (getline(file, line))
+    {
+        const size_t line_offset = offset;
+        offset += line.length() + 1;
         lineno++;
+        // getline drops the \n but, like the in-memory parser, keeps everything else.
+        StrLineParser::event_t event = parser.feed(line, lineno, &part);
+
+        // The line is overwritten by the next one, so errors are reported right away.
+        if (parser.error.kind != StrParseError::NONE)
+        {
+            report_error(parser.error);
+            parser.error = StrParseError();
+        }
+
+        switch (event)
+        {
+            case StrLineParser::SKIPPED:
+                break;
+            case StrLineParser::LABEL:
+                label = part;
+                entry->lineno = lineno;
+                break;
+            case StrLineParser::STR:
+                raw_str = part;
+                raw_str_offset = line_offset + (part.data() - line.data());
+                break;
+            case StrLineParser::END:
+                entry->label = label;
+                entry->raw_str = raw_str;
+                return true;
+        }
     }
+    return false;
+}
+
+bool StrStreamReader::next(Entry *entry)
+{
+    StrEntryView view;
+    if (!next(&view))
+        return false;
+
+    entry->label = view.label;
+    entry->str.clear();
+    entry->str.reserve(view.raw_str.length());
+    unescape_each(view.raw_str, [entry](char ch) { entry->str.push_back(ch); });
+    entry->extra_data.clear();
+    entry->lineno = view.lineno;
+    return true;
+}
+
+/**
+ * Read entries from str files.
+ * Unlike StrFile, all strings are unescaped and copied out of the file.
+ */
+std::vector<Entry> read_entries(const std::string &fname, int num_threads)
+{
+    StrFile strf(fname, num_threads);
+    vector<Entry> result(strf.entries.size());
+
+    const size_t chunk_size = 4096;
+    const size_t num_chunks = (result.size() + chunk_size - 1) / chunk_size;
+    parallel_for(num_chunks, num_threads, [&](size_t k)
+    {
+        const size_t end = min(result.size(), (k + 1) * chunk_size);
+        for (size_t i = k * chunk_size ; i < end ; i++)
+        {
+            const StrEntryView &view = strf.entries[i];
+            Entry &entry = result[i];
+            entry.label = string(view.label);
+            entry.str = view.str();
+            entry.lineno = view.lineno;
+        }
+    });
 
-    fs.close();
     return result;
 }
+
+/**
+ * Read entries from str files into table. Labels and unescaped strings are copied into its arena.
+ */
+void read_entries(const std::string &fname, StringTable *table, int num_threads)
+{
+    StrFile strf(fname, num_threads);
+    table->entries.reserve(table->entries.size() + strf.entries.size());
+
+    for (const StrEntryView &view: strf.entries)
+    {
+        TableEntry entry;
+        entry.label = table->arena.store(view.label);
+
+        // Unescaping never makes a string longer.
+        char *out = table->arena.reserve(view.raw_str.length());
+        size_t len = 0;
+        unescape_each(view.raw_str, [out, &len](char ch) { out[len++] = ch; });
+        entry.str = table->arena.commit(len);
+
+        entry.lineno = view.lineno;
+        table->entries.push_back(entry);
+    }
+}
+
+/**
+ * Append entries [first, end) of strf to table, unescaping the strings.
+ */
+void append_entries(ColumnTable *table, const vector<StrEntryView> &entries, size_t first)
+{
+    size_t label_bytes = 0;
+    size_t str_bytes = 0;
+    for (size_t i = first ; i < entries.size() ; i++)
+    {
+        label_bytes += entries[i].label.length();
+        str_bytes += entries[i].raw_str.length();
+    }
+    table->reserve(table->size() + entries.size() - first);
+    table->labels.reserve(0, table->labels.blob.size() + label_bytes);
+    table->strs.reserve(0, table->strs.blob.size() + str_bytes);
+
+    for (size_t i = first ; i < entries.size() ; i++)
+    {
+        const StrEntryView &view = entries[i];
+
+        // Unescaping never makes a string longer.
+        char *out = table->strs.append_space(view.raw_str.length());
+        size_t len = 0;
+        unescape_each(view.raw_str, [out, &len](char ch) { out[len++] = ch; });
+        table->strs.commit(len);
+
+        table->push_back(view.label, view.lineno);
+    }
+}
+
+void read_entries(const std::string &fname, ColumnTable *table, int num_threads)
+{
+    StrFile strf(fname, num_threads);
+    append_entries(table, strf.entries);
+}
+
+void StringColumn::reserve(size_t num_strings, size_t num_bytes)
+{
+    offsets.reserve(num_strings + 1);
+    blob.reserve(num_bytes);
+}
+
+void StringColumn::push_back(string_view s)
+{
+    char *out = append_space(s.length());
+    memcpy(out, s.data(), s.length());
+    commit(s.length());
+}
+
+char *StringColumn::append_space(size_t n)
+{
+    ASSERT(offsets.back() + n <= UINT32_MAX, "String column would exceed 4 GB");
+    blob.resize(offsets.back() + n);
+    return &blob[offsets.back()];
+}
+
+void StringColumn::commit(size_t n)
+{
+    ASSERT(offsets.back() + n <= blob.size(), "Committing more than appended");
+    offsets.push_back(offsets.back() + n);
+    blob.resize(offsets.back());
+}
+
+string_view ColumnTable::extra_data(size_t i) const
+{
+    if (!has_extra_data(i))
+        return string_view();
+    return extras[extra_index[i]];
+}
+
+void ColumnTable::reserve(size_t num_entries)
+{
+    labels.offsets.reserve(num_entries + 1);
+    strs.offsets.reserve(num_entries + 1);
+    flags.reserve(num_entries);
+    extra_index.reserve(num_entries);
+    linenos.reserve(num_entries);
+}
+
+void ColumnTable::push_back(string_view label, string_view str, int lineno)
+{
+    strs.push_back(str);
+    push_back(label, lineno);
+}
+
+void ColumnTable::push_back(string_view label, int lineno)
+{
+    ASSERT(strs.size() == labels.size() + 1, "The string of " << label << " must be added first");
+    labels.push_back(label);
+    flags.push_back(0);
+    extra_index.push_back(0);
+    linenos.push_back(lineno);
+}
+
+void ColumnTable::set_extra_data(size_t i, string_view extra_data)
+{
+    flags[i] |= HAS_EXTRA_DATA;
+    extra_index[i] = extras.size();
+    extras.push_back(extra_data);
+}
+
+StringArena::StringArena(size_t block_size):
+    block_size(block_size)
+{
+}
+
+char *StringArena::reserve(size_t n)
+{
+    if (n > left)
+    {
+        // Strings bigger than a block get a block of their own.
+        size_t size = max(n, block_size);
+        blocks.emplace_back(new char[size]);
+        cur = blocks.back().get();
+        left = size;
+        total += size;
+    }
+    return cur;
+}
+
+string_view StringArena::commit(size_t n)
+{
+    ASSERT(n <= left, "Committing more than reserved");
+    string_view result(cur, n);
+    cur += n;
+    left -= n;
+    return result;
+}
+
+string_view StringArena::store(string_view s)
+{
+    char *p = reserve(s.length());
+    memcpy(p, s.data(), s.length());
+    return commit(s.length());
+}
+
+int resolve_num_threads(int num_threads)
+{
+    if (num_threads > 0)
+        return num_threads;
+    return max(1u, thread::hardware_concurrency());
+}
+
+void parallel_for(size_t n, int num_threads, const function<void(size_t)> &fn)
+{
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++ ; i < n ; i = next++)
+            fn(i);
+    };
+
+    vector<thread> threads;
+    for (int t = 1 ; t < num_threads && (size_t) t < n ; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (thread &t: threads)
+        t.join();
+}
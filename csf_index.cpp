@@ -0,0 +1,211 @@
+/**
+ * Label index for CSF files, kept in a .csfidx file next to them.
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "include/csf_index.hpp"
+#include "include/utf16.hpp"
+
+using namespace std;
+
+string build_csf_index(string_view data, const vector<CsfEntryRef> &entries)
+{
+    vector<CsfIndexEntry> index(entries.size());
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        index[i].offset = entries[i].label_offset - sizeof(LabelHeader);
+        index[i].label_length = entries[i].label_length;
+        index[i].number = i;
+    }
+
+    auto label_of = [data](const CsfIndexEntry &e)
+    {
+        return data.substr(e.offset + sizeof(LabelHeader), e.label_length);
+    };
+    sort(index.begin(), index.end(), [&label_of](const CsfIndexEntry &a, const CsfIndexEntry &b)
+    {
+        int c = label_of(a).compare(label_of(b));
+        return c < 0 || (c == 0 && a.number < b.number);
+    });
+
+    CsfIndexHeader index_header;
+    index_header.csf_size = data.length();
+    index_header.csf_checksum = checksum_bytes(data);
+    index_header.num_labels = index.size();
+
+    string result;
+    result.reserve(sizeof(CsfIndexHeader) + index.size() * sizeof(CsfIndexEntry));
+    result.append((const char *) &index_header, sizeof(CsfIndexHeader));
+    result.append((const char *) index.data(), index.size() * sizeof(CsfIndexEntry));
+    return result;
+}
+
+string csf_index_fname(const string &fname)
+{
+    const string ext = ".csf";
+    if (fname.length() >= ext.length() && fname.compare(fname.length() - ext.length(), ext.length(), ext) == 0)
+        return fname + "idx";
+    return fname + ".csfidx";
+}
+
+IndexedCsfFile::IndexedCsfFile(const string &fname):
+    file(fname)
+{
+    header = CSFHeader();
+    header.num_labels = header.num_strings = header.unused = header.lang_code = 0;
+    bool ok = parse_csf_header(file.view(), &header);
+    ASSERT(ok, fname << " is too short to be a CSF file.");
+    if (!ok)
+        return;
+
+    const string idxfname = csf_index_fname(fname);
+    if (file_exists(idxfname) && load_index(idxfname))
+        return;
+
+    // Missing or stale: build it again, and save it for next time if we can.
+    built_index = build_csf_index(file.view(), scan_csf_entries(file.view(), header));
+    entries_begin = (const CsfIndexEntry *) (built_index.data() + sizeof(CsfIndexHeader));
+    num_labels = (built_index.size() - sizeof(CsfIndexHeader)) / sizeof(CsfIndexEntry);
+    was_rebuilt = true;
+    try_write_file_atomic(idxfname, built_index);
+}
+
+/**
+ * Map the index and check that it belongs to the CSF file as it is now.
+ * The checksum reads the whole CSF file, but unlike scanning it, touches each byte only once.
+ */
+bool IndexedCsfFile::load_index(const string &idxfname)
+{
+    index_file = MappedFile(idxfname);
+    const string_view data = index_file.view();
+
+    CsfIndexHeader expected;
+    CsfIndexHeader index_header;
+    if (data.length() < sizeof(CsfIndexHeader))
+        return false;
+    memcpy(&index_header, data.data(), sizeof(CsfIndexHeader));
+
+    bool ok = memcmp(index_header.magic, expected.magic, 4) == 0
+        && index_header.version == expected.version
+        && index_header.csf_size == file.size()
+        && data.length() == sizeof(CsfIndexHeader) + index_header.num_labels * sizeof(CsfIndexEntry)
+        && index_header.csf_checksum == checksum_bytes(file.view());
+    if (ok)
+    {
+        entries_begin = (const CsfIndexEntry *) (data.data() + sizeof(CsfIndexHeader));
+        num_labels = index_header.num_labels;
+        ok = check_index_entries();
+    }
+    if (!ok)
+    {
+        index_file = MappedFile();
+        entries_begin = nullptr;
+        num_labels = 0;
+    }
+    return ok;
+}
+
+/**
+ * Every label must lie inside the CSF file, so that a damaged index is rebuilt instead of
+ * reading out of bounds. Only the index is read, not the CSF file.
+ */
+bool IndexedCsfFile::check_index_entries() const
+{
+    const size_t size = file.size();
+    for (size_t k = 0 ; k < num_labels ; k++)
+    {
+        const CsfIndexEntry &e = index_entry(k);
+        if (e.offset > size || size - e.offset < sizeof(LabelHeader)
+            || e.label_length > size - e.offset - sizeof(LabelHeader) || e.number >= num_labels)
+            return false;
+    }
+    return true;
+}
+
+string_view IndexedCsfFile::label(size_t k) const
+{
+    const CsfIndexEntry &e = index_entry(k);
+    return file.view().substr(e.offset + sizeof(LabelHeader), e.label_length);
+}
+
+CsfEntryRef IndexedCsfFile::entry_ref(size_t k) const
+{
+    size_t pos = index_entry(k).offset;
+    CsfEntryRef ref;
+    bool ok = parse_entry(file.view(), &pos, &ref);
+    ASSERT(ok, "Label #" << index_entry(k).number << " runs past the end of the CSF file");
+    if (!ok)
+        ref = CsfEntryRef{pos, 0, pos, 0, pos, 0, false};
+    return ref;
+}
+
+string IndexedCsfFile::str(size_t k) const
+{
+    const CsfEntryRef ref = entry_ref(k);
+    return flipped_utf16_to_utf8(file.data() + ref.str_offset, ref.str_length);
+}
+
+string_view IndexedCsfFile::extra_data(size_t k) const
+{
+    const CsfEntryRef ref = entry_ref(k);
+    return string_view(file.data() + ref.extra_offset, ref.extra_length);
+}
+
+size_t IndexedCsfFile::lower_bound(string_view label) const
+{
+    size_t lo = 0;
+    size_t hi = num_labels;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (this->label(mid) < label)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+size_t IndexedCsfFile::upper_bound(string_view label) const
+{
+    size_t lo = 0;
+    size_t hi = num_labels;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (this->label(mid) <= label)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * First position whose label, cut to the length of prefix, sorts after prefix.
+ */
+size_t IndexedCsfFile::upper_bound_prefix(string_view prefix) const
+{
+    size_t lo = 0;
+    size_t hi = num_labels;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (label(mid).substr(0, prefix.length()) <= prefix)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+pair<size_t, size_t> IndexedCsfFile::equal_range(string_view label) const
+{
+    return make_pair(lower_bound(label), upper_bound(label));
+}
+
+pair<size_t, size_t> IndexedCsfFile::prefix_range(string_view prefix) const
+{
+    return make_pair(lower_bound(prefix), upper_bound_prefix(prefix));
+}
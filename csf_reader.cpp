@@ -0,0 +1,355 @@
+/**
+ * See https://www.modenc.renegadeprojects.com/CSF_File_Format for CSF format!
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "include/csf_reader.hpp"
+#include "include/utf16.hpp"
+
+using namespace std;
+
+/**
+ * Copy n bytes at *pos into dst, if there are that many left.
+ */
+bool read_bytes(string_view data, size_t *pos, void *dst, size_t n)
+{
+    if (data.length() - *pos < n)
+        return false;
+    memcpy(dst, data.data() + *pos, n);
+    *pos += n;
+    return true;
+}
+
+/**
+ * Skip n bytes, if there are that many left.
+ */
+bool skip_bytes(string_view data, size_t *pos, size_t n)
+{
+    if (data.length() - *pos < n)
+        return false;
+    *pos += n;
+    return true;
+}
+
+bool parse_csf_header(string_view data, CSFHeader *header)
+{
+    size_t pos = 0;
+    if (!read_bytes(data, &pos, header, sizeof(CSFHeader)))
+        return false;
+    ASSERT(strncmp(header->magic, " FSC", 4) == 0, "Given input file does not begin with \" FSC\"!"); // reverse of CSF
+    ASSERT(header->csf_format == 3, "CSF format 3 is not supported. (RA2 through RA3 should work though)");
+    return true;
+}
+
+bool is_valid_label_header(const LabelHeader &label_header)
+{
+    return label_header.num_string_pairs == 1 && strncmp(label_header.magic, " LBL", 4) == 0;
+}
+
+bool is_valid_str_header(const StrHeader &str_header)
+{
+    return strncmp(str_header.magic, "WRTS", 4) == 0 || strncmp(str_header.magic, " RTS", 4) == 0;
+}
+
+void check_label_header(const LabelHeader &label_header)
+{
+    ASSERT(label_header.num_string_pairs == 1, "labels with more than 1 string pairs is not supported! (and should not appear in any of the C&C games...)");
+    ASSERT(strncmp(label_header.magic, " LBL", 4) == 0, "Label header does not begin with \" LBL\"!");
+}
+
+/**
+ * True for STRW, which is followed by extra data, false for plain STR.
+ */
+bool is_wide_str_header(const StrHeader &str_header)
+{
+    if (strncmp(str_header.magic, "WRTS", 4) == 0) // reverse of STRW
+        return true;
+    ASSERT(strncmp(str_header.magic, " RTS", 4) == 0, "Invalid string header, expecting WRTS or RTS"); // reverse of STR
+    return false;
+}
+
+/**
+ * Find where the parts of the label at *pos are, without decoding anything.
+ * *pos is advanced to the next label.
+ * With strict, bad headers make it return false instead of asserting.
+ */
+bool parse_entry(string_view data, size_t *pos, CsfEntryRef *ref, bool strict)
+{
+    // Read the label header
+    LabelHeader label_header;
+    if (!read_bytes(data, pos, &label_header, sizeof(LabelHeader)))
+        return false;
+    if (strict && !is_valid_label_header(label_header))
+        return false;
+    check_label_header(label_header);
+
+    // The label
+    ref->label_offset = *pos;
+    ref->label_length = label_header.length;
+    if (!skip_bytes(data, pos, label_header.length))
+        return false;
+
+    // The string part
+    StrHeader str_header;
+    if (!read_bytes(data, pos, &str_header, sizeof(StrHeader)))
+        return false;
+    if (strict && !is_valid_str_header(str_header))
+        return false;
+    ref->has_extra_data = is_wide_str_header(str_header);
+    ref->str_offset = *pos;
+    ref->str_length = str_header.length;
+    if (!skip_bytes(data, pos, 2 * (size_t) str_header.length))
+        return false;
+
+    ref->extra_offset = *pos;
+    ref->extra_length = 0;
+    if (ref->has_extra_data)
+    {
+        if (!read_bytes(data, pos, &ref->extra_length, sizeof(uint32_t)))
+            return false;
+        ref->extra_offset = *pos;
+        if (!skip_bytes(data, pos, ref->extra_length))
+            return false;
+    }
+
+    return true;
+}
+
+bool parse_entry(string_view data, size_t *pos, CsfEntryRef *ref)
+{
+    return parse_entry(data, pos, ref, false);
+}
+
+bool try_scan_csf(string_view data, CSFHeader *header, vector<CsfEntryRef> *entries, string *error)
+{
+    auto fail = [error](const string &message)
+    {
+        if (error != nullptr)
+            *error = message;
+        return false;
+    };
+
+    size_t pos = 0;
+    if (!read_bytes(data, &pos, header, sizeof(CSFHeader)))
+        return fail("too short to be a CSF file");
+    if (strncmp(header->magic, " FSC", 4) != 0)
+        return fail("does not begin with \" FSC\"");
+    if (header->csf_format != 3)
+        return fail("CSF format " + to_string(header->csf_format) + " is not supported");
+
+    entries->clear();
+    entries->reserve(min<size_t>(header->num_labels, data.length() / sizeof(LabelHeader)));
+    for (size_t i = 0 ; i < header->num_labels ; i++)
+    {
+        CsfEntryRef ref;
+        if (!parse_entry(data, &pos, &ref, true))
+            return fail("label #" + to_string(i) + " is truncated or has a bad header");
+        entries->push_back(ref);
+    }
+    return true;
+}
+
+/**
+ * Build the offset table of all labels that follow the CSF header.
+ */
+vector<CsfEntryRef> scan_csf_entries(string_view data, const CSFHeader &header)
+{
+    vector<CsfEntryRef> result;
+    // Don't trust num_labels too much for the reservation, the file may be truncated.
+    result.reserve(min<size_t>(header.num_labels, data.length() / sizeof(LabelHeader)));
+
+    size_t pos = sizeof(CSFHeader);
+    for (size_t i = 0 ; i < header.num_labels ; i++)
+    {
+        CsfEntryRef ref;
+        bool ok = parse_entry(data, &pos, &ref);
+        ASSERT(ok, "Unexpected end of CSF file at label #" << i << ", expected " << header.num_labels << " labels.");
+        if (!ok)
+            break;
+        result.push_back(ref);
+    }
+
+    return result;
+}
+
+CsfFile::CsfFile(const string &fname):
+    file(fname),
+    data(file.view())
+{
+    scan(fname);
+}
+
+CsfFile::CsfFile(const char *data, size_t size):
+    data(data, size)
+{
+    scan("CSF data");
+}
+
+void CsfFile::scan(const string &name)
+{
+    bool ok = parse_csf_header(data, &header);
+    ASSERT(ok, name << " is too short to be a CSF file.");
+    if (!ok)
+    {
+        header = CSFHeader();
+        header.num_labels = header.num_strings = header.unused = header.lang_code = 0;
+        return;
+    }
+    entries = scan_csf_entries(data, header);
+}
+
+string_view CsfFile::label(size_t i) const
+{
+    const CsfEntryRef &ref = entries[i];
+    return string_view(data.data() + ref.label_offset, ref.label_length);
+}
+
+string CsfFile::str(size_t i) const
+{
+    const CsfEntryRef &ref = entries[i];
+    return flipped_utf16_to_utf8(data.data() + ref.str_offset, ref.str_length);
+}
+
+string_view CsfFile::extra_data(size_t i) const
+{
+    const CsfEntryRef &ref = entries[i];
+    return string_view(data.data() + ref.extra_offset, ref.extra_length);
+}
+
+Entry CsfFile::entry(size_t i) const
+{
+    Entry result;
+    result.label = string(label(i));
+    result.str = str(i);
+    result.extra_data = string(extra_data(i));
+    return result;
+}
+
+string_view CsfFile::raw_entry(size_t i) const
+{
+    const CsfEntryRef &ref = entries[i];
+    const size_t begin = ref.label_offset - sizeof(LabelHeader);
+    size_t end = ref.str_offset + 2 * (size_t) ref.str_length;
+    if (ref.has_extra_data)
+        end = ref.extra_offset + ref.extra_length;
+    return string_view(data.data() + begin, end - begin);
+}
+
+void CsfFile::read_entries(StringTable *table) const
+{
+    table->entries.reserve(table->entries.size() + entries.size());
+
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const CsfEntryRef &ref = entries[i];
+        TableEntry entry;
+        entry.label = table->arena.store(label(i));
+
+        char *out = table->arena.reserve(3 * (size_t) ref.str_length);
+        entry.str = table->arena.commit(flipped_utf16_to_utf8(data.data() + ref.str_offset, ref.str_length, out));
+
+        if (ref.has_extra_data)
+            entry.extra_data = table->arena.store(extra_data(i));
+        table->entries.push_back(entry);
+    }
+}
+
+void CsfFile::read_entries(ColumnTable *table) const
+{
+    table->reserve(table->size() + entries.size());
+
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const CsfEntryRef &ref = entries[i];
+        char *out = table->strs.append_space(3 * (size_t) ref.str_length);
+        table->strs.commit(flipped_utf16_to_utf8(data.data() + ref.str_offset, ref.str_length, out));
+        table->push_back(label(i));
+
+        if (ref.has_extra_data)
+            table->set_extra_data(table->size() - 1, extra_data(i));
+    }
+}
+
+string CsfStreamEntry::str() const
+{
+    return flipped_utf16_to_utf8(utf16.data(), str_length());
+}
+
+CsfStreamReader::CsfStreamReader(const string &fname)
+{
+    header = CSFHeader();
+    header.num_labels = header.num_strings = header.unused = header.lang_code = 0;
+
+    fp = fopen(fname.c_str(), "rb");
+    ASSERT(fp != nullptr, "Failed to open " << fname);
+    if (fp == nullptr)
+        return;
+    setvbuf(fp, nullptr, _IOFBF, 1 << 16);
+
+    char buf[sizeof(CSFHeader)];
+    bool ok = read_exact(buf, sizeof(buf)) && parse_csf_header(string_view(buf, sizeof(buf)), &header);
+    ASSERT(ok, fname << " is too short to be a CSF file.");
+    if (!ok)
+        header.num_labels = 0;
+}
+
+CsfStreamReader::~CsfStreamReader()
+{
+    if (fp != nullptr)
+        fclose(fp);
+}
+
+bool CsfStreamReader::read_exact(void *dst, size_t n)
+{
+    return fread(dst, 1, n, fp) == n;
+}
+
+/**
+ * Lengths come from the file, so a corrupt one must not allocate gigabytes up front.
+ * The string only grows as far as the data actually goes.
+ */
+bool CsfStreamReader::read_string(string *dst, size_t n)
+{
+    const size_t piece = 1 << 16;
+    dst->clear();
+    while (dst->length() < n)
+    {
+        size_t old_length = dst->length();
+        size_t len = min(piece, n - old_length);
+        dst->resize(old_length + len);
+        if (!read_exact(&(*dst)[old_length], len))
+            return false;
+    }
+    return true;
+}
+
+bool CsfStreamReader::next(CsfStreamEntry *entry)
+{
+    if (fp == nullptr || num_read >= header.num_labels)
+        return false;
+
+    LabelHeader label_header;
+    StrHeader str_header;
+    bool ok = read_exact(&label_header, sizeof(LabelHeader));
+    if (ok)
+        check_label_header(label_header);
+    ok = ok && read_string(&entry->label, label_header.length);
+    ok = ok && read_exact(&str_header, sizeof(StrHeader));
+    if (ok)
+        entry->has_extra_data = is_wide_str_header(str_header);
+    ok = ok && read_string(&entry->utf16, 2 * (size_t) str_header.length);
+
+    entry->extra_data.clear();
+    if (ok && entry->has_extra_data)
+    {
+        uint32_t extra_length;
+        ok = read_exact(&extra_length, sizeof(uint32_t)) && read_string(&entry->extra_data, extra_length);
+    }
+
+    ASSERT(ok, "Unexpected end of CSF file at label #" << num_read << ", expected " << header.num_labels << " labels.");
+    if (!ok)
+        return false;
+    num_read++;
+    return true;
+}
@@ -0,0 +1,216 @@
+/**
+ * See https://www.modenc.renegadeprojects.com/CSF_File_Format for CSF format!
+ */
+#include <cstring>
+
+#include "include/csf_writer.hpp"
+#include "include/utf16.hpp"
+
+using namespace std;
+
+size_t entry_size(string_view label, uint32_t utf16_length, bool has_extra_data, string_view extra_data)
+{
+    size_t size = sizeof(LabelHeader) + label.length();
+    size += sizeof(StrHeader) + 2 * (size_t) utf16_length;
+    if (has_extra_data)
+        size += sizeof(uint32_t) + extra_data.length();
+    return size;
+}
+
+size_t csf_size(const vector<Entry> &entries, vector<uint32_t> *utf16_lengths)
+{
+    size_t size = sizeof(CSFHeader);
+    utf16_lengths->resize(entries.size());
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const Entry &e = entries[i];
+        (*utf16_lengths)[i] = utf16_length(e.str);
+        size += entry_size(e.label, (*utf16_lengths)[i], !e.extra_data.empty(), e.extra_data);
+    }
+    return size;
+}
+
+size_t csf_size(const ColumnTable &table, vector<uint32_t> *utf16_lengths)
+{
+    size_t size = sizeof(CSFHeader);
+    utf16_lengths->resize(table.size());
+    for (size_t i = 0 ; i < table.size() ; i++)
+    {
+        (*utf16_lengths)[i] = utf16_length(table.str(i));
+        size += entry_size(table.label(i), (*utf16_lengths)[i], table.has_extra_data(i), table.extra_data(i));
+    }
+    return size;
+}
+
+char *write_bytes(char *out, const void *src, size_t n)
+{
+    memcpy(out, src, n);
+    return out + n;
+}
+
+/**
+ * Write one label at out, which must have room for entry_size() bytes.
+ * Returns the end of what was written.
+ */
+char *write_entry
+(
+    char *out,
+    string_view label, string_view str,
+    bool has_extra_data, string_view extra_data,
+    int lineno, uint32_t utf16_length
+)
+{
+    static const char *STR = " RTS";
+    static const char *STRW = "WRTS";
+
+    LabelHeader lh;
+    lh.length = label.length();
+    out = write_bytes(out, &lh, sizeof(LabelHeader));
+    out = write_bytes(out, label.data(), label.length());
+
+    // Now, let's write content.
+    StrHeader sh;
+    memcpy(sh.magic, has_extra_data ? STRW : STR, 4);
+    sh.length = utf16_length;
+    out = write_bytes(out, &sh, sizeof(StrHeader));
+
+    size_t error_offset;
+    size_t len = utf8_to_flipped_utf16(str, out, &error_offset);
+    ASSERT(error_offset == string_view::npos, "\nSTR file line " << lineno + 1 << ": invalid UTF-8 at byte " << error_offset << " of the string of " << label);
+    ASSERT(len == utf16_length, "UTF-16 length of " << label << " changed while encoding");
+    out += 2 * (size_t) utf16_length;
+
+    // Write extra data, if there is.
+    if (has_extra_data)
+    {
+        uint32_t extra_length = extra_data.length();
+        out = write_bytes(out, &extra_length, sizeof(uint32_t));
+        out = write_bytes(out, extra_data.data(), extra_data.length());
+    }
+
+    return out;
+}
+
+void append_csf_entry
+(
+    string *out,
+    string_view label, string_view str,
+    bool has_extra_data, string_view extra_data,
+    int lineno
+)
+{
+    const uint32_t length = utf16_length(str);
+    const size_t old_size = out->size();
+    out->resize(old_size + entry_size(label, length, has_extra_data, extra_data));
+    char *end = write_entry(&(*out)[old_size], label, str, has_extra_data, extra_data, lineno, length);
+    ASSERT(end == &(*out)[0] + out->size(), "Entry size was computed wrong");
+}
+
+string encode_csf(const CSFHeader &header, const vector<Entry> &entries)
+{
+    vector<uint32_t> utf16_lengths;
+    string result(csf_size(entries, &utf16_lengths), '\0');
+
+    char *out = write_bytes(&result[0], &header, sizeof(CSFHeader));
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const Entry &e = entries[i];
+        out = write_entry(out, e.label, e.str, !e.extra_data.empty(), e.extra_data, e.lineno, utf16_lengths[i]);
+    }
+
+    ASSERT(out == &result[0] + result.size(), "CSF size was computed wrong");
+    return result;
+}
+
+string encode_csf(const CSFHeader &header, const ColumnTable &table)
+{
+    vector<uint32_t> utf16_lengths;
+    string result(csf_size(table, &utf16_lengths), '\0');
+
+    char *out = write_bytes(&result[0], &header, sizeof(CSFHeader));
+    for (size_t i = 0 ; i < table.size() ; i++)
+    {
+        out = write_entry
+        (
+            out, table.label(i), table.str(i),
+            table.has_extra_data(i), table.extra_data(i),
+            table.linenos[i], utf16_lengths[i]
+        );
+    }
+
+    ASSERT(out == &result[0] + result.size(), "CSF size was computed wrong");
+    return result;
+}
+
+CsfStreamWriter::CsfStreamWriter(const string &fname, const CSFHeader &header):
+    fname(fname),
+    tmpfname(fname + ".tmp"),
+    header(header)
+{
+    fp = fopen(tmpfname.c_str(), "wb");
+    ASSERT(fp != nullptr, "Failed to open " << tmpfname << " for writing");
+    if (fp == nullptr)
+        return;
+    setvbuf(fp, nullptr, _IOFBF, 1 << 16);
+
+    this->header.num_labels = this->header.num_strings = 0;
+    ok = fwrite(&this->header, sizeof(CSFHeader), 1, fp) == 1;
+}
+
+CsfStreamWriter::~CsfStreamWriter()
+{
+    // Not finished, so the file is incomplete.
+    if (fp != nullptr)
+    {
+        fclose(fp);
+        remove(tmpfname.c_str());
+    }
+}
+
+void CsfStreamWriter::write(const Entry &e)
+{
+    write(e.label, e.str, !e.extra_data.empty(), e.extra_data, e.lineno);
+}
+
+void CsfStreamWriter::write
+(
+    string_view label, string_view str,
+    bool has_extra_data, string_view extra_data,
+    int lineno
+)
+{
+    if (fp == nullptr)
+        return;
+
+    buffer.clear();
+    append_csf_entry(&buffer, label, str, has_extra_data, extra_data, lineno);
+    write_encoded(buffer, 1);
+}
+
+void CsfStreamWriter::write_encoded(string_view records, size_t num_entries)
+{
+    if (fp == nullptr)
+        return;
+
+    ok = fwrite(records.data(), sizeof(char), records.size(), fp) == records.size() && ok;
+    header.num_labels += num_entries;
+    header.num_strings += num_entries;
+}
+
+bool CsfStreamWriter::finish()
+{
+    if (fp == nullptr)
+        return false;
+
+    ok = fseek(fp, 0, SEEK_SET) == 0 && ok;
+    ok = fwrite(&header, sizeof(CSFHeader), 1, fp) == 1 && ok;
+    ok = fclose(fp) == 0 && ok;
+    fp = nullptr;
+    ASSERT(ok, "Failed to write " << tmpfname);
+    if (!ok)
+    {
+        remove(tmpfname.c_str());
+        return false;
+    }
+    return replace_file(tmpfname, fname);
+}
@@ -0,0 +1,319 @@
+/**
+ * Convert many CSF and STR files in one process, several at once.
+ * Each job is what csf2str or str2csf would do, picked by the extension of its input.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "include/csfstuff.hpp"
+
+using namespace std;
+
+void show_usage()
+{
+    cout << "Usage: csfbatch [-j N] manifest.txt" << endl;
+    cout << "       csfbatch [-j N] input1 output1 input2 output2 ..." << endl;
+    cout << endl;
+    cout << "    Converts .csf inputs to STR and .str inputs to CSF, all in one process." << endl;
+    cout << "    -j N: run N conversions at once. 0 means one per core. Default is 0." << endl;
+    cout << "          With fewer files than threads, the spare threads split the files." << endl;
+    cout << endl;
+    cout << "    The manifest has one job per line: input output [extra_data.json]" << endl;
+    cout << "    Names with spaces go in double quotes. Empty lines and lines starting with # are skipped." << endl;
+    cout << "    Extra data defaults to the STR file name with a .json extension:" << endl;
+    cout << "    it is written there when converting from CSF if there is any," << endl;
+    cout << "    and read from there when converting to CSF if the file exists." << endl;
+}
+
+class BatchJob
+{
+public:
+    string ifname;
+    string ofname;
+    string extrafname;
+    bool to_str = false;
+
+    // Filled in by run_job.
+    bool ok = false;
+    size_t input_size = 0;
+    size_t num_entries = 0;
+    double seconds = 0;
+};
+
+bool has_extension(const string &fname, const string &ext)
+{
+    if (fname.length() < ext.length())
+        return false;
+    string tail = fname.substr(fname.length() - ext.length());
+    transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == ext;
+}
+
+string json_fname(const string &strfname)
+{
+    if (has_extension(strfname, ".str"))
+        return strfname.substr(0, strfname.length() - 4) + ".json";
+    return strfname + ".json";
+}
+
+/**
+ * Returns false if the input is neither a CSF nor a STR file.
+ */
+bool make_job(const string &ifname, const string &ofname, const string &extrafname, BatchJob *job)
+{
+    job->ifname = ifname;
+    job->ofname = ofname;
+    job->to_str = has_extension(ifname, ".csf");
+    if (!job->to_str && !has_extension(ifname, ".str"))
+    {
+        cerr << ifname << " is neither a .csf nor a .str file" << endl;
+        return false;
+    }
+    job->extrafname = !extrafname.empty() ? extrafname : json_fname(job->to_str ? ofname : ifname);
+    return true;
+}
+
+/**
+ * Whitespace separated fields, where double quotes group spaces into one field.
+ */
+vector<string> split_fields(const string &line)
+{
+    vector<string> fields;
+    size_t i = 0;
+    while (i < line.length())
+    {
+        if (isspace((unsigned char) line[i]))
+        {
+            i++;
+            continue;
+        }
+
+        string field;
+        if (line[i] == '"')
+        {
+            size_t end = line.find('"', i + 1);
+            if (end == string::npos)
+                end = line.length();
+            field = line.substr(i + 1, end - i - 1);
+            i = end + 1;
+        }
+        else
+        {
+            while (i < line.length() && !isspace((unsigned char) line[i]))
+                field += line[i++];
+        }
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+/**
+ * Returns false on a malformed manifest.
+ */
+bool read_manifest(const string &fname, vector<BatchJob> *jobs)
+{
+    ifstream f(fname);
+    if (!f)
+    {
+        cerr << "Failed to open " << fname << endl;
+        return false;
+    }
+
+    string line;
+    for (int lineno = 1 ; getline(f, line) ; lineno++)
+    {
+        const vector<string> fields = split_fields(line);
+        if (fields.empty() || fields[0][0] == '#')
+            continue;
+        if (fields.size() < 2 || fields.size() > 3)
+        {
+            cerr << fname << " line " << lineno << ": expected input output [extra_data.json]" << endl;
+            return false;
+        }
+
+        BatchJob job;
+        if (!make_job(fields[0], fields[1], fields.size() == 3 ? fields[2] : "", &job))
+            return false;
+        jobs->push_back(job);
+    }
+    return true;
+}
+
+/**
+ * Here and in str_to_csf_file, malformed inputs and failed writes are reported
+ * without asserting, so that they only fail their own job.
+ */
+void csf_to_str_file(BatchJob *job, int num_threads)
+{
+    MappedFile input(job->ifname);
+    CSFHeader header;
+    vector<CsfEntryRef> entries;
+    string error;
+    if (!try_scan_csf(input.view(), &header, &entries, &error))
+    {
+        cerr << job->ifname << ": " << error << endl;
+        return;
+    }
+
+    CsfFile csf(input.data(), input.size());
+    FILE *of = fopen(job->ofname.c_str(), "w");
+    if (of == nullptr)
+    {
+        cerr << "Failed to open " << job->ofname << " for writing" << endl;
+        return;
+    }
+    csf_to_str(csf, [of](string_view piece)
+    {
+        fwrite(piece.data(), sizeof(char), piece.length(), of);
+    }, num_threads);
+    job->ok = ferror(of) == 0;
+    job->ok = fclose(of) == 0 && job->ok;
+
+    const string extra_data = extra_data_to_json(csf);
+    if (!extra_data.empty())
+        job->ok = try_write_file_atomic(job->extrafname, extra_data) && job->ok;
+
+    job->input_size = csf.data.length();
+    job->num_entries = csf.entries.size();
+}
+
+void str_to_csf_file(BatchJob *job, int num_threads)
+{
+    MappedFile input(job->ifname);
+    MappedFile extra_data;
+    if (file_exists(job->extrafname))
+        extra_data = MappedFile(job->extrafname);
+
+    CSFHeader header;
+    ColumnTable table;
+    string error;
+    if (!try_read_str(input.view(), extra_data.view(), &header, &table, num_threads, &error))
+    {
+        cerr << job->ifname << ": " << error << endl;
+        return;
+    }
+    job->ok = try_write_file_atomic(job->ofname, encode_csf(header, table));
+    if (!job->ok)
+        cerr << "Failed to write " << job->ofname << endl;
+
+    job->input_size = input.size();
+    job->num_entries = table.size();
+}
+
+/**
+ * A failed job is reported at the end instead of stopping the others.
+ */
+void run_job(BatchJob *job, int num_threads)
+{
+    auto start = chrono::steady_clock::now();
+    if (!file_exists(job->ifname))
+        cerr << "Failed to open " << job->ifname << endl;
+    else
+    {
+        try
+        {
+            if (job->to_str)
+                csf_to_str_file(job, num_threads);
+            else
+                str_to_csf_file(job, num_threads);
+        }
+        catch (const exception &ex)
+        {
+            cerr << job->ifname << ": " << ex.what() << endl;
+            job->ok = false;
+        }
+    }
+    job->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void print_throughput(const char *name, size_t num_entries, size_t num_bytes, double seconds)
+{
+    seconds = max(seconds, 1e-9);
+    printf("%s: %zu entries, %.2f MB in %.1f ms, %.1f MB/s, %.0f entries/s\n",
+        name, num_entries, num_bytes / 1e6, seconds * 1e3, num_bytes / seconds / 1e6, num_entries / seconds);
+}
+
+int main(int argc, const char *argv[])
+{
+    vector<string> args;
+    int num_threads = 0;
+    for (int i = 1 ; i < argc ; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+            num_threads = atoi(argv[++i]);
+        else
+            args.push_back(arg);
+    }
+    num_threads = resolve_num_threads(num_threads);
+
+    vector<BatchJob> jobs;
+    if (args.size() == 1)
+    {
+        if (!read_manifest(args[0], &jobs))
+            return 2;
+    }
+    else if (args.size() >= 2 && args.size() % 2 == 0)
+    {
+        for (size_t i = 0 ; i < args.size() ; i += 2)
+        {
+            BatchJob job;
+            if (!make_job(args[i], args[i + 1], "", &job))
+                return 2;
+            jobs.push_back(job);
+        }
+    }
+    else
+    {
+        show_usage();
+        return 0;
+    }
+
+    // Biggest files first, so that a big one picked up last doesn't keep the others waiting.
+    // Each thread takes the next job as soon as it is done with its own.
+    vector<size_t> order(jobs.size());
+    vector<size_t> sizes(jobs.size(), 0);
+    for (size_t i = 0 ; i < jobs.size() ; i++)
+    {
+        order[i] = i;
+        if (file_exists(jobs[i].ifname))
+            sizes[i] = MappedFile(jobs[i].ifname).size();
+    }
+    stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    const int threads_per_job = max<int>(1, num_threads / max<size_t>(1, jobs.size()));
+    auto start = chrono::steady_clock::now();
+    parallel_for(jobs.size(), num_threads, [&](size_t k)
+    {
+        run_job(&jobs[order[k]], threads_per_job);
+    });
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t num_entries = 0;
+    size_t num_bytes = 0;
+    size_t num_failed = 0;
+    for (const BatchJob &job: jobs)
+    {
+        const string name = job.ifname + " -> " + job.ofname;
+        if (!job.ok)
+        {
+            printf("%s: FAILED\n", name.c_str());
+            num_failed++;
+            continue;
+        }
+        print_throughput(name.c_str(), job.num_entries, job.input_size, job.seconds);
+        num_entries += job.num_entries;
+        num_bytes += job.input_size;
+    }
+
+    const string total = "Total of " + to_string(jobs.size() - num_failed) + " files on " + to_string(num_threads) + " threads";
+    print_throughput(total.c_str(), num_entries, num_bytes, seconds);
+    if (num_failed > 0)
+        printf("%zu files failed\n", num_failed);
+    return num_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * Look labels up in a CSF or STR file without converting all of it.
+ * A label index is kept next to CSF files, see csf_index.hpp.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "include/common.hpp"
+#include "include/csf_index.hpp"
+
+using namespace std;
+
+void show_usage()
+{
+    cout << "Usage: csfquery input.csf|input.str COMMAND ..." << endl;
+    cout << endl;
+    cout << "    Commands:" << endl;
+    cout << "        get LABEL [LABEL ...]: the entries of the given labels." << endl;
+    cout << "        prefix PREFIX: all entries whose label starts with PREFIX, sorted by label." << endl;
+    cout << "        grep REGEX: all entries whose label or string contains a match of REGEX, in file order." << endl;
+    cout << endl;
+    cout << "    Entries are printed in STR format. Exits with 1 if a label is not found or nothing matches." << endl;
+    cout << "    For CSF files, input.csfidx is created or refreshed as needed, to speed up later queries." << endl;
+}
+
+/**
+ * STR file with its entries sorted by label, with the same interface as IndexedCsfFile.
+ * STR files parse fast enough that no index file is kept.
+ */
+class IndexedStrFile
+{
+public:
+    explicit IndexedStrFile(const string &fname):
+        file(fname),
+        order(file.entries.size())
+    {
+        for (size_t i = 0 ; i < order.size() ; i++)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return file.entries[a].label < file.entries[b].label;
+        });
+    }
+
+    size_t size() const { return order.size(); }
+    string_view label(size_t k) const { return file.entries[order[k]].label; }
+    size_t position(size_t k) const { return order[k]; }
+    string str(size_t k) const { return file.entries[order[k]].str(); }
+
+    pair<size_t, size_t> equal_range(string_view label) const
+    {
+        auto range = std::equal_range(order.begin(), order.end(), label, LabelLess{this, string_view::npos});
+        return make_pair(range.first - order.begin(), range.second - order.begin());
+    }
+
+    pair<size_t, size_t> prefix_range(string_view prefix) const
+    {
+        auto range = std::equal_range(order.begin(), order.end(), prefix, LabelLess{this, prefix.length()});
+        return make_pair(range.first - order.begin(), range.second - order.begin());
+    }
+
+private:
+    /**
+     * Compares labels cut to length with a key, in both directions as equal_range wants.
+     */
+    struct LabelLess
+    {
+        const IndexedStrFile *self;
+        size_t length;
+
+        bool operator()(uint32_t i, string_view key) const { return cut(i) < key; }
+        bool operator()(string_view key, uint32_t i) const { return key < cut(i); }
+        string_view cut(uint32_t i) const { return self->file.entries[i].label.substr(0, length); }
+    };
+
+    StrFile file;
+    vector<uint32_t> order;
+};
+
+template <class Table>
+void append_range(const Table &table, pair<size_t, size_t> range, string *out)
+{
+    for (size_t k = range.first ; k < range.second ; k++)
+        append_entry_to_str(out, table.label(k), table.str(k), out->empty());
+}
+
+/**
+ * Returns false if any label is missing.
+ */
+template <class Table>
+bool get_labels(const Table &table, const vector<string> &labels, string *out)
+{
+    bool found_all = true;
+    for (const string &label: labels)
+    {
+        pair<size_t, size_t> range = table.equal_range(label);
+        if (range.first == range.second)
+        {
+            cerr << "Label not found: " << label << endl;
+            found_all = false;
+        }
+        append_range(table, range, out);
+    }
+    return found_all;
+}
+
+/**
+ * Returns false if nothing matched.
+ */
+template <class Table>
+bool grep_entries(const Table &table, const regex &pattern, string *out)
+{
+    vector<pair<size_t, size_t>> matches; // position in the file, position in label order
+    for (size_t k = 0 ; k < table.size() ; k++)
+    {
+        const string_view label = table.label(k);
+        bool match = regex_search(label.begin(), label.end(), pattern);
+        if (!match)
+        {
+            const string str = table.str(k);
+            match = regex_search(str, pattern);
+        }
+        if (match)
+            matches.emplace_back(table.position(k), k);
+    }
+
+    sort(matches.begin(), matches.end());
+    for (const pair<size_t, size_t> &m: matches)
+        append_range(table, make_pair(m.second, m.second + 1), out);
+    return !matches.empty();
+}
+
+/**
+ * Returns 0 on success, 1 if something wasn't found and 2 on bad arguments.
+ */
+template <class Table>
+int run_query(const Table &table, const string &command, const vector<string> &args, string *out)
+{
+    if (command == "get")
+        return get_labels(table, args, out) ? 0 : 1;
+
+    if (args.size() != 1)
+    {
+        show_usage();
+        return 2;
+    }
+
+    if (command == "prefix")
+    {
+        pair<size_t, size_t> range = table.prefix_range(args[0]);
+        append_range(table, range, out);
+        return range.first < range.second ? 0 : 1;
+    }
+
+    if (command == "grep")
+    {
+        regex pattern;
+        try
+        {
+            pattern = regex(args[0]);
+        }
+        catch (const regex_error &ex)
+        {
+            cerr << "Invalid regular expression " << args[0] << ": " << ex.what() << endl;
+            return 2;
+        }
+        return grep_entries(table, pattern, out) ? 0 : 1;
+    }
+
+    show_usage();
+    return 2;
+}
+
+bool is_str_file(const string &fname)
+{
+    const string ext = ".str";
+    if (fname.length() < ext.length())
+        return false;
+    string tail = fname.substr(fname.length() - ext.length());
+    transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == ext;
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 4)
+    {
+        show_usage();
+        return 0;
+    }
+
+    const string ifname = argv[1];
+    const string command = argv[2];
+    const vector<string> args(argv + 3, argv + argc);
+
+    string out;
+    int result;
+    if (is_str_file(ifname))
+        result = run_query(IndexedStrFile(ifname), command, args, &out);
+    else
+        result = run_query(IndexedCsfFile(ifname), command, args, &out);
+
+    fwrite(out.data(), sizeof(char), out.length(), stdout);
+    return result;
+}
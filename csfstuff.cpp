@@ -0,0 +1,755 @@
+/**
+ * In-memory conversions behind csf2str, str2csf and merge_str.
+ * See https://www.modenc.renegadeprojects.com/CSF_File_Format for CSF format!
+ */
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "include/csfstuff.hpp"
+#include "include/utf16.hpp"
+#include "include/json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * Let's embed metadata into the STR file rather than having a separate meta.json.
+ * In csf2str and str2csf, we assume CSFSTUFF:META appears as the first entry!
+ */
+string header_to_metadata(const CSFHeader &header)
+{
+    json j;
+    j["lang_code"] = header.lang_code;
+    j["unused"] = header.unused;
+    return j.dump();
+}
+
+json parse_metadata(const string &str)
+{
+    json j;
+    try
+    {
+        j = json::parse(str);
+    }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << '\n';
+        std::cerr << "Error parsing CSF metadata in CSFSTUFF:META: got \'" << str << "\'" << endl;
+        throw ex;
+    }
+    return j;
+}
+
+json default_metadata()
+{
+    // By default, lang_code == 0 (en_US), unused == 0.
+    cerr << "Warning: CSFSTUFF:META must exist and appear as the first item. Falling back to default CSF metadata of language_code=0 and unused=0" << endl;
+    return json::parse("{\"lang_code\":0,\"unused\":0}");
+}
+
+CSFHeader metadata_to_header(const string &metadata, size_t num_labels)
+{
+    json j = metadata.empty() ? default_metadata() : parse_metadata(metadata);
+    CSFHeader header;
+    header.num_labels = num_labels;
+    header.num_strings = num_labels;
+    header.unused = j["unused"];
+    header.lang_code = j["lang_code"];
+    return header;
+}
+
+/**
+ * Decode entries [begin, end) into STR text.
+ * The metadata entry always comes first, so none of these is the first entry of the file.
+ */
+string decode_chunk(const CsfFile &csf, size_t begin, size_t end)
+{
+    string result;
+    for (size_t i = begin ; i < end ; i++)
+        append_entry_to_str(&result, csf.label(i), csf.str(i), false);
+    return result;
+}
+
+/**
+ * Entries are independent once the offset table is built, so the strings are decoded
+ * chunk by chunk on num_threads threads. Only a window of chunks is kept in memory,
+ * and the window is written in the original order before moving on.
+ */
+void csf_to_str(const CsfFile &csf, const function<void(string_view)> &write, int num_threads)
+{
+    string metadata;
+    append_entry_to_str(&metadata, "CSFSTUFF:META", header_to_metadata(csf.header), true);
+    write(metadata);
+
+    const size_t chunk_size = 256; // entries
+    const size_t window_size = chunk_size * 4 * num_threads;
+    const size_t num_entries = csf.entries.size();
+    vector<string> chunks;
+
+    for (size_t window_begin = 0 ; window_begin < num_entries ; window_begin += window_size)
+    {
+        const size_t window_end = min(num_entries, window_begin + window_size);
+        const size_t num_chunks = (window_end - window_begin + chunk_size - 1) / chunk_size;
+        chunks.assign(num_chunks, string());
+
+        parallel_for(num_chunks, num_threads, [&](size_t k)
+        {
+            size_t begin = window_begin + k * chunk_size;
+            size_t end = min(window_end, begin + chunk_size);
+            chunks[k] = decode_chunk(csf, begin, end);
+        });
+
+        for (const string &chunk: chunks)
+            write(chunk);
+    }
+}
+
+string extra_data_to_json(const CsfFile &csf)
+{
+    json extra_data;
+    for (size_t i = 0 ; i < csf.entries.size() ; i++)
+    {
+        string_view extra = csf.extra_data(i);
+        if (!extra.empty())
+            extra_data[string(csf.label(i))] = string(extra);
+    }
+    return extra_data.empty() ? string() : extra_data.dump(2);
+}
+
+string csf_to_str(string_view csf, string *extra_data_json, int num_threads)
+{
+    CsfFile csff(csf.data(), csf.length());
+    string result;
+    result.reserve(csf.length());
+    csf_to_str(csff, [&result](string_view piece) { result.append(piece); }, num_threads);
+    *extra_data_json = extra_data_to_json(csff);
+    return result;
+}
+
+/**
+ * Same escaping as json::dump(), without building a json value.
+ */
+void append_json_string(string *out, string_view s)
+{
+    static const char *hex = "0123456789abcdef";
+    out->push_back('"');
+    for (unsigned char ch: s)
+    {
+        switch (ch)
+        {
+        case '"': out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\b': out->append("\\b"); break;
+        case '\f': out->append("\\f"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+            if (ch < 0x20)
+            {
+                out->append("\\u00");
+                out->push_back(hex[ch >> 4]);
+                out->push_back(hex[ch & 0xf]);
+            }
+            else
+                out->push_back(ch);
+        }
+    }
+    out->push_back('"');
+}
+
+/**
+ * Writes extra_data.json one label at a time, laid out like json::dump(2).
+ * The file is only created once there is something to write.
+ */
+class ExtraDataWriter
+{
+public:
+    explicit ExtraDataWriter(const string &fname): fname(fname) {}
+    ~ExtraDataWriter() { close(); }
+
+    void add(string_view label, string_view extra_data)
+    {
+        if (fp == nullptr)
+        {
+            fp = fopen(fname.c_str(), "w");
+            ASSERT(fp != nullptr, "Failed to open " << fname);
+            buffer = "{\n";
+        }
+        else
+            buffer += ",\n";
+
+        buffer += "  ";
+        append_json_string(&buffer, label);
+        buffer += ": ";
+        append_json_string(&buffer, extra_data);
+
+        if (buffer.length() >= (1 << 16))
+            flush();
+    }
+
+    /**
+     * Returns true if the file was written.
+     */
+    bool close()
+    {
+        if (fp == nullptr)
+            return false;
+        buffer += "\n}";
+        flush();
+        fclose(fp);
+        fp = nullptr;
+        return true;
+    }
+
+private:
+    void flush()
+    {
+        if (fp != nullptr)
+            fwrite(buffer.data(), sizeof(char), buffer.length(), fp);
+        buffer.clear();
+    }
+
+    string fname;
+    FILE *fp = nullptr;
+    string buffer;
+};
+
+/**
+ * The CSF file goes through a window of labels, decoded on num_threads threads,
+ * then written in order. Extra data goes straight to its file.
+ */
+bool stream_csf_file_to_str
+(
+    const string &ifname,
+    const string &ofname,
+    const string &extrafname,
+    int num_threads,
+    bool *wrote_extra_data
+)
+{
+    CsfStreamReader reader(ifname);
+    if (!reader.is_open())
+        return false;
+
+    FILE *of = fopen(ofname.c_str(), "w");
+    string metadata;
+    append_entry_to_str(&metadata, "CSFSTUFF:META", header_to_metadata(reader.header), true);
+    fwrite(metadata.data(), sizeof(char), metadata.length(), of);
+
+    ExtraDataWriter extra_writer(extrafname);
+    const size_t chunk_size = 256; // entries
+    const size_t window_size = chunk_size * 4 * num_threads;
+    vector<CsfStreamEntry> window(window_size);
+    vector<string> chunks;
+
+    for (;;)
+    {
+        size_t n = 0;
+        while (n < window_size && reader.next(&window[n]))
+        {
+            if (window[n].has_extra_data && !window[n].extra_data.empty())
+                extra_writer.add(window[n].label, window[n].extra_data);
+            n++;
+        }
+        if (n == 0)
+            break;
+
+        const size_t num_chunks = (n + chunk_size - 1) / chunk_size;
+        chunks.resize(num_chunks);
+        parallel_for(num_chunks, num_threads, [&](size_t k)
+        {
+            string &chunk = chunks[k];
+            chunk.clear();
+            for (size_t i = k * chunk_size ; i < min(n, (k + 1) * chunk_size) ; i++)
+                append_entry_to_str(&chunk, window[i].label, window[i].str(), false);
+        });
+
+        for (size_t k = 0 ; k < num_chunks ; k++)
+            fwrite(chunks[k].data(), sizeof(char), chunks[k].length(), of);
+    }
+
+    fclose(of);
+
+    const bool wrote = extra_writer.close();
+    if (wrote_extra_data != nullptr)
+        *wrote_extra_data = wrote;
+    return true;
+}
+
+/**
+ * Copy extra data from extra_data.json into the entries they belong to.
+ * Only the label column is scanned.
+ */
+void attach_extra_data(ColumnTable *table, const json &extra_data)
+{
+    if (extra_data.empty())
+        return;
+
+    string label;
+    for (size_t i = 0 ; i < table->size() ; i++)
+    {
+        label = table->label(i);
+        auto ed = extra_data.find(label);
+        if (ed != extra_data.end())
+            table->set_extra_data(i, ed->get_ref<const string &>());
+    }
+}
+
+bool read_csf(string_view csf, CSFHeader *header, ColumnTable *table)
+{
+    vector<CsfEntryRef> entries;
+    if (!try_scan_csf(csf, header, &entries))
+        return false;
+    CsfFile(csf.data(), csf.length()).read_entries(table);
+    return true;
+}
+
+void read_str_entries
+(
+    const vector<StrEntryView> &entries, string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table
+)
+{
+    size_t first = 0;
+    string metadata;
+    if (!entries.empty() && entries[0].label == "CSFSTUFF:META")
+    {
+        metadata = entries[0].str();
+        first = 1; // Skip the entry so that we get perfect reconstruction.
+    }
+
+    const size_t num_existing = table->size();
+    append_entries(table, entries, first);
+    if (!extra_data_json.empty())
+        attach_extra_data(table, json::parse(extra_data_json));
+    *header = metadata_to_header(metadata, table->size() - num_existing);
+}
+
+void read_str
+(
+    string_view str, string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table, int num_threads
+)
+{
+    read_str_entries(parse_str_entries(str, num_threads), extra_data_json, header, table);
+}
+
+bool check_str_strings(const vector<StrEntryView> &entries, string *error)
+{
+    string str;
+    string utf16;
+    for (const StrEntryView &e: entries)
+    {
+        size_t error_offset = string_view::npos;
+        if (has_valid_escapes(e.raw_str))
+        {
+            str = e.str();
+            utf16.resize(2 * str.length());
+            utf8_to_flipped_utf16(str, &utf16[0], &error_offset);
+            if (error_offset == string_view::npos)
+                continue;
+        }
+
+        if (error != nullptr)
+        {
+            *error = "line " + to_string(e.lineno + 1) + ": the string of " + string(e.label);
+            *error += error_offset == string_view::npos ? " has an unknown escape" : " has invalid UTF-8 at byte " + to_string(error_offset);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool try_read_str
+(
+    string_view str, string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table, int num_threads, string *error
+)
+{
+    vector<StrEntryView> entries;
+    if (!try_parse_str_entries(str, num_threads, &entries, error) || !check_str_strings(entries, error))
+        return false;
+    read_str_entries(entries, extra_data_json, header, table);
+    return true;
+}
+
+string encode_str(const CSFHeader &header, const ColumnTable &table)
+{
+    string result;
+    append_entry_to_str(&result, "CSFSTUFF:META", header_to_metadata(header), true);
+    for (size_t i = 0 ; i < table.size() ; i++)
+        append_entry_to_str(&result, table.label(i), table.str(i), false);
+    return result;
+}
+
+/**
+ * The whole file is encoded into one buffer of exactly the right size.
+ */
+string str_to_csf(string_view str, string_view extra_data_json, int num_threads)
+{
+    CSFHeader header;
+    ColumnTable table;
+    read_str(str, extra_data_json, &header, &table, num_threads);
+    return encode_csf(header, table);
+}
+
+/**
+ * A block of a STR file on its way through str_file_to_csf.
+ */
+class StrBatch
+{
+public:
+    size_t number = 0;
+    string text; // complete lines, possibly ending with the start of an entry.
+    vector<StrEntryView> entries; // views into text.
+    string records; // CSF label records of the entries.
+};
+
+/**
+ * State shared by the stages of str_file_to_csf, guarded by mutex.
+ */
+class StrPipeline
+{
+public:
+    mutex m;
+    condition_variable changed;
+    deque<unique_ptr<StrBatch>> to_encode;
+    map<size_t, unique_ptr<StrBatch>> to_write; // by batch number
+    size_t in_flight = 0; // batches read and not written yet
+    size_t num_batches = 0;
+    bool done_reading = false;
+    string error; // of the first malformed line, which ends reading
+    string metadata; // set before the first batch goes out
+};
+
+/**
+ * Reader stage: read the file in blocks, cut them at line ends and parse the complete entries.
+ * An entry cut by the block end is carried over to the next batch.
+ */
+void read_str_batches(FILE *fp, StrPipeline *pipeline, size_t max_in_flight)
+{
+    const size_t block_size = 1 << 20;
+    string carry;
+    int lineno = 0;
+    bool eof = false;
+    for (size_t number = 0 ; !eof ; number++)
+    {
+        {
+            unique_lock<mutex> lock(pipeline->m);
+            pipeline->changed.wait(lock, [&]() { return pipeline->in_flight < max_in_flight; });
+            pipeline->in_flight++;
+        }
+
+        unique_ptr<StrBatch> batch(new StrBatch);
+        batch->number = number;
+        batch->text.swap(carry);
+        const size_t old_size = batch->text.size();
+        batch->text.resize(old_size + block_size);
+        const size_t n = fread(&batch->text[old_size], sizeof(char), block_size, fp);
+        batch->text.resize(old_size + n);
+        eof = n < block_size;
+
+        size_t cut = batch->text.length();
+        if (!eof)
+        {
+            cut = batch->text.rfind('\n');
+            cut = (cut == string::npos) ? 0 : cut + 1;
+        }
+        int num_lines;
+        string error;
+        const size_t consumed = parse_str_block(string_view(batch->text).substr(0, cut), lineno, eof, &batch->entries, &num_lines, &error);
+        lineno += num_lines;
+        if (!eof)
+            carry.assign(batch->text, consumed, string::npos);
+
+        unique_lock<mutex> lock(pipeline->m);
+        if (!error.empty())
+        {
+            // Batches in flight are still written, but the output is thrown away.
+            pipeline->error = error;
+            pipeline->in_flight--;
+            break;
+        }
+        if (number == 0 && !batch->entries.empty() && batch->entries[0].label == "CSFSTUFF:META")
+        {
+            pipeline->metadata = batch->entries[0].str();
+            batch->entries.erase(batch->entries.begin()); // Skip the entry so that we get perfect reconstruction.
+        }
+        pipeline->to_encode.push_back(move(batch));
+        pipeline->num_batches = number + 1;
+        pipeline->changed.notify_all();
+    }
+
+    unique_lock<mutex> lock(pipeline->m);
+    pipeline->done_reading = true;
+    pipeline->changed.notify_all();
+}
+
+/**
+ * Encoder stage: turn batches into CSF label records, in whatever order they come.
+ */
+void encode_str_batches(StrPipeline *pipeline, const json &extra_data)
+{
+    for (;;)
+    {
+        unique_ptr<StrBatch> batch;
+        {
+            unique_lock<mutex> lock(pipeline->m);
+            pipeline->changed.wait(lock, [&]() { return !pipeline->to_encode.empty() || pipeline->done_reading; });
+            if (pipeline->to_encode.empty())
+                return;
+            batch = move(pipeline->to_encode.front());
+            pipeline->to_encode.pop_front();
+        }
+
+        batch->records.reserve(2 * batch->text.size());
+        for (const StrEntryView &e: batch->entries)
+        {
+            if (extra_data.empty())
+            {
+                append_csf_entry(&batch->records, e.label, e.str(), false, "", e.lineno);
+                continue;
+            }
+            auto ed = extra_data.find(string(e.label));
+            if (ed == extra_data.end())
+                append_csf_entry(&batch->records, e.label, e.str(), false, "", e.lineno);
+            else
+                append_csf_entry(&batch->records, e.label, e.str(), true, ed->get_ref<const string &>(), e.lineno);
+        }
+
+        unique_lock<mutex> lock(pipeline->m);
+        pipeline->to_write[batch->number] = move(batch);
+        pipeline->changed.notify_all();
+    }
+}
+
+bool str_file_to_csf(const string &ifname, const string &ofname, string_view extra_data_json, int num_threads)
+{
+    const json extra_data = extra_data_json.empty() ? json::object() : json::parse(extra_data_json);
+    const size_t max_in_flight = 2 * num_threads + 2;
+
+    FILE *fp = fopen(ifname.c_str(), "rb");
+    ASSERT(fp != nullptr, "Failed to open " << ifname);
+    if (fp == nullptr)
+        return false;
+
+    StrPipeline pipeline;
+    thread reader(read_str_batches, fp, &pipeline, max_in_flight);
+    vector<thread> encoders;
+    for (int i = 0 ; i < num_threads ; i++)
+        encoders.emplace_back(encode_str_batches, &pipeline, cref(extra_data));
+
+    // Writer stage, here: batches go out in file order.
+    unique_ptr<CsfStreamWriter> writer;
+    for (size_t number = 0 ; ; number++)
+    {
+        unique_ptr<StrBatch> batch;
+        {
+            unique_lock<mutex> lock(pipeline.m);
+            pipeline.changed.wait(lock, [&]()
+            {
+                return pipeline.to_write.count(number) > 0 || (pipeline.done_reading && number >= pipeline.num_batches);
+            });
+            auto it = pipeline.to_write.find(number);
+            if (it == pipeline.to_write.end())
+                break;
+            batch = move(it->second);
+            pipeline.to_write.erase(it);
+        }
+
+        // The first batch has been read, so the metadata is known.
+        if (writer == nullptr)
+            writer.reset(new CsfStreamWriter(ofname, metadata_to_header(pipeline.metadata, 0)));
+        writer->write_encoded(batch->records, batch->entries.size());
+        batch.reset();
+
+        unique_lock<mutex> lock(pipeline.m);
+        pipeline.in_flight--;
+        pipeline.changed.notify_all();
+    }
+
+    reader.join();
+    for (thread &t: encoders)
+        t.join();
+    fclose(fp);
+
+    if (!pipeline.error.empty())
+    {
+        writer.reset(); // Not finished, so it removes its temporary file.
+        cerr << pipeline.error << endl;
+        return false;
+    }
+    if (writer == nullptr)
+        writer.reset(new CsfStreamWriter(ofname, metadata_to_header(pipeline.metadata, 0)));
+    return writer->finish();
+}
+
+/**
+ * The counts in the header are patched once all entries are written.
+ */
+bool stream_str_file_to_csf(const string &ifname, const string &ofname, string_view extra_data_json)
+{
+    const json extra_data = extra_data_json.empty() ? json::object() : json::parse(extra_data_json);
+
+    StrStreamReader reader(ifname);
+    Entry e;
+    bool has_entry = reader.next(&e);
+
+    string metadata;
+    if (has_entry && e.label == "CSFSTUFF:META")
+    {
+        metadata = e.str;
+        has_entry = reader.next(&e); // Skip the entry so that we get perfect reconstruction.
+    }
+
+    CsfStreamWriter writer(ofname, metadata_to_header(metadata, 0));
+    for ( ; has_entry ; has_entry = reader.next(&e))
+    {
+        auto ed = extra_data.find(e.label);
+        if (ed == extra_data.end())
+            writer.write(e.label, e.str, false, "", e.lineno);
+        else
+            writer.write(e.label, e.str, true, ed->get_ref<const string &>(), e.lineno);
+    }
+    return writer.finish();
+}
+
+string merge_str_entries(const vector<vector<StrEntryView>> &inputs)
+{
+    // to merge the STR entries while preserving order of entry appearance, we need a lookup table
+    MergedEntries merged;
+    for (size_t i = 0 ; i < inputs.size() ; i++)
+        merge_entries(&merged, inputs[i], i);
+
+    string result;
+    for (size_t i = 0 ; i < merged.entries.size() ; i++)
+        append_entry_to_str(&result, merged.entries[i], i == 0);
+    return result;
+}
+
+string merge_strs(const vector<string_view> &strs, int num_threads)
+{
+    // Texts are parsed independently, several at once, and the threads left over
+    // split each text. Only the merge has to follow the given order.
+    vector<vector<StrEntryView>> inputs(strs.size());
+    const int threads_per_input = max<int>(1, num_threads / max<size_t>(1, strs.size()));
+    parallel_for(strs.size(), num_threads, [&](size_t i)
+    {
+        inputs[i] = parse_str_entries(strs[i], threads_per_input);
+    });
+    return merge_str_entries(inputs);
+}
+
+/**
+ * Where the winning string of a label is, for the streaming merge.
+ */
+struct StrLocation
+{
+    size_t offset;
+    uint32_t length;
+};
+
+/**
+ * The streaming merge result. Labels are copied into an arena, strings stay in the input files.
+ */
+class MergedLocations
+{
+public:
+    StringArena labels;
+    vector<string_view> entries; // labels, in order of first appearance
+    vector<StrLocation> locations;
+    vector<uint32_t> sources;
+    LabelIndex lut; // label -> index into entries
+};
+
+/**
+ * First pass: read fname front to back and merge the location of each string.
+ */
+void merge_locations(MergedLocations *merged, const string &fname, uint32_t source)
+{
+    StrStreamReader reader(fname);
+    StrEntryView e;
+    while (reader.next(&e))
+    {
+        // The label is only kept if it turns out to be new, otherwise the space is reused.
+        char *label_copy = merged->labels.reserve(e.label.length());
+        memcpy(label_copy, e.label.data(), e.label.length());
+        const string_view label(label_copy, e.label.length());
+
+        const StrLocation location = {reader.str_offset(), (uint32_t) e.raw_str.length()};
+        uint32_t existing;
+        switch (merge_label(&merged->lut, merged->sources, label, source, merged->entries.size(), &existing))
+        {
+            case APPEND:
+                merged->entries.push_back(merged->labels.commit(label.length()));
+                merged->locations.push_back(location);
+                merged->sources.push_back(source);
+                break;
+            case REPLACE:
+                merged->locations[existing] = location;
+                merged->sources[existing] = source;
+                break;
+        }
+    }
+}
+
+/**
+ * Second pass: read each winning string back from its file and write the entries in order.
+ * Only the output buffer and one string are in memory at a time.
+ */
+void write_locations_to_str(const string &ofname, const vector<string> &ifnames, const MergedLocations &merged)
+{
+    vector<FILE *> inputs;
+    for (const string &ifname: ifnames)
+    {
+        inputs.push_back(fopen(ifname.c_str(), "rb"));
+        ASSERT(inputs.back() != nullptr, "Failed to open " << ifname);
+    }
+
+    FILE *fp = fopen(ofname.c_str(), "w");
+    string buffer;
+    string raw_str;
+    for (size_t i = 0 ; i < merged.entries.size() ; i++)
+    {
+        const StrLocation &location = merged.locations[i];
+        FILE *input = inputs[merged.sources[i]];
+        raw_str.resize(location.length);
+        bool ok = fseek(input, location.offset, SEEK_SET) == 0
+            && fread(&raw_str[0], sizeof(char), raw_str.length(), input) == raw_str.length();
+        ASSERT(ok, "Failed to read the string of " << merged.entries[i] << " back from " << ifnames[merged.sources[i]]);
+
+        StrEntryView entry;
+        entry.label = merged.entries[i];
+        entry.raw_str = raw_str;
+        append_entry_to_str(&buffer, entry, i == 0);
+        if (buffer.length() >= (1 << 16))
+        {
+            fwrite(buffer.data(), sizeof(char), buffer.length(), fp);
+            buffer.clear();
+        }
+    }
+    fwrite(buffer.data(), sizeof(char), buffer.length(), fp);
+    fclose(fp);
+
+    for (FILE *input: inputs)
+    {
+        if (input != nullptr)
+            fclose(input);
+    }
+}
+
+void stream_merge_str_files(const vector<string> &ifnames, const string &ofname)
+{
+    MergedLocations merged;
+    for (size_t i = 0 ; i < ifnames.size() ; i++)
+        merge_locations(&merged, ifnames[i], i);
+    write_locations_to_str(ofname, ifnames, merged);
+}
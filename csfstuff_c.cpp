@@ -0,0 +1,142 @@
+/**
+ * C interface to the csfstuff library, see include/csfstuff_c.h.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+#include "include/csfstuff.hpp"
+#include "include/csfstuff_c.h"
+#include "include/label_index.hpp"
+
+using namespace std;
+
+struct csfstuff_table
+{
+    CSFHeader header;
+    ColumnTable table;
+    LabelIndex lut; // label -> index of its first entry.
+};
+
+/**
+ * The index points into the label column, which doesn't change once opened.
+ */
+void index_labels(csfstuff_table *table)
+{
+    for (size_t i = 0 ; i < table->table.size() ; i++)
+        table->lut.insert(table->table.label(i), i);
+}
+
+/**
+ * Copy data into a buffer from malloc, so the caller can free it without C++.
+ */
+int copy_out(const string &data, char **out, size_t *out_size)
+{
+    *out = (char *) malloc(data.length() > 0 ? data.length() : 1);
+    if (*out == nullptr)
+        return 0;
+    memcpy(*out, data.data(), data.length());
+    *out_size = data.length();
+    return 1;
+}
+
+csfstuff_table *csfstuff_open_csf(const char *data, size_t size)
+{
+    csfstuff_table *result = new csfstuff_table;
+    if (!read_csf(string_view(data, size), &result->header, &result->table))
+    {
+        delete result;
+        return nullptr;
+    }
+    index_labels(result);
+    return result;
+}
+
+/**
+ * Exceptions must not cross into C, nor may malformed input reach the library's assertions.
+ */
+csfstuff_table *csfstuff_open_str
+(
+    const char *data, size_t size,
+    const char *extra_data_json, size_t extra_data_json_size,
+    int num_threads
+)
+{
+    csfstuff_table *result = new csfstuff_table;
+    try
+    {
+        const string_view extra_data(extra_data_json, extra_data_json != nullptr ? extra_data_json_size : 0);
+        string error;
+        if (!try_read_str(string_view(data, size), extra_data, &result->header, &result->table, resolve_num_threads(num_threads), &error))
+        {
+            cerr << error << endl;
+            delete result;
+            return nullptr;
+        }
+    }
+    catch (const exception &ex)
+    {
+        cerr << ex.what() << endl;
+        delete result;
+        return nullptr;
+    }
+    index_labels(result);
+    return result;
+}
+
+void csfstuff_free_table(csfstuff_table *table)
+{
+    delete table;
+}
+
+size_t csfstuff_size(const csfstuff_table *table)
+{
+    return table->table.size();
+}
+
+uint32_t csfstuff_lang_code(const csfstuff_table *table)
+{
+    return table->header.lang_code;
+}
+
+int csfstuff_get_entry(const csfstuff_table *table, size_t i, csfstuff_entry *entry)
+{
+    const ColumnTable &t = table->table;
+    if (i >= t.size())
+        return 0;
+
+    const string_view label = t.label(i);
+    const string_view str = t.str(i);
+    const string_view extra_data = t.has_extra_data(i) ? t.extra_data(i) : string_view();
+    entry->label = label.data();
+    entry->label_length = label.length();
+    entry->str = str.data();
+    entry->str_length = str.length();
+    entry->extra_data = extra_data.data();
+    entry->extra_data_length = extra_data.length();
+    entry->has_extra_data = t.has_extra_data(i);
+    return 1;
+}
+
+int64_t csfstuff_find(const csfstuff_table *table, const char *label, size_t label_length)
+{
+    const uint32_t i = table->lut.find(string_view(label, label_length));
+    return i == LabelIndex::NOT_FOUND ? -1 : (int64_t) i;
+}
+
+int csfstuff_encode_csf(const csfstuff_table *table, char **out, size_t *out_size)
+{
+    CSFHeader header = table->header;
+    header.num_labels = header.num_strings = table->table.size();
+    return copy_out(encode_csf(header, table->table), out, out_size);
+}
+
+int csfstuff_encode_str(const csfstuff_table *table, char **out, size_t *out_size)
+{
+    return copy_out(encode_str(table->header, table->table), out, out_size);
+}
+
+void csfstuff_free(void *buffer)
+{
+    free(buffer);
+}
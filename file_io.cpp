@@ -0,0 +1,251 @@
+#include "include/file_io.hpp"
+#include "include/common.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string &fname)
+{
+    HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    ASSERT(file != INVALID_HANDLE_VALUE, fname << " does not exists!");
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    opened = true;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    len = (size_t) file_size.QuadPart;
+    if (len > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        ASSERT(mapping != NULL, "Failed to map " << fname);
+        if (mapping != NULL)
+            ptr = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (ptr == nullptr)
+            len = 0;
+    }
+    CloseHandle(file);
+}
+
+bool file_exists(const string &fname)
+{
+    DWORD attributes = GetFileAttributesA(fname.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool make_directory(const string &dirname)
+{
+    CreateDirectoryA(dirname.c_str(), NULL);
+    DWORD attributes = GetFileAttributesA(dirname.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+unsigned long process_id()
+{
+    return GetCurrentProcessId();
+}
+
+void MappedFile::unmap()
+{
+    if (ptr != nullptr)
+        UnmapViewOfFile(ptr);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    ptr = nullptr;
+    mapping = nullptr;
+    len = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const string &fname)
+{
+    int fd = open(fname.c_str(), O_RDONLY);
+    ASSERT(fd >= 0, fname << " does not exists!");
+    if (fd < 0)
+        return;
+    opened = true;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ASSERT(p != MAP_FAILED, "Failed to map " << fname);
+        if (p != MAP_FAILED)
+        {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            ptr = (const char *) p;
+            len = st.st_size;
+        }
+    }
+    close(fd);
+}
+
+bool file_exists(const string &fname)
+{
+    struct stat st;
+    return stat(fname.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool make_directory(const string &dirname)
+{
+    mkdir(dirname.c_str(), 0777);
+    struct stat st;
+    return stat(dirname.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+unsigned long process_id()
+{
+    return getpid();
+}
+
+void MappedFile::unmap()
+{
+    if (ptr != nullptr)
+        munmap((void *) ptr, len);
+    ptr = nullptr;
+    len = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+    unmap();
+    ptr = other.ptr;
+    len = other.len;
+    opened = other.opened;
+    other.ptr = nullptr;
+    other.len = 0;
+#ifdef _WIN32
+    mapping = other.mapping;
+    other.mapping = nullptr;
+#endif
+    return *this;
+}
+
+uint64_t rotate_left(uint64_t x, int n)
+{
+    return (x << n) | (x >> (64 - n));
+}
+
+/**
+ * Four independent lanes over 8 byte words, so the multiplies overlap.
+ * The lanes and the tail are folded together with the length at the end.
+ */
+uint64_t checksum_bytes(string_view data)
+{
+    const uint64_t prime = 0x9e3779b97f4a7c15ull;
+    uint64_t lanes[4] = {0x243f6a8885a308d3ull, 0x13198a2e03707344ull, 0xa4093822299f31d0ull, 0x082efa98ec4e6c89ull};
+
+    const char *p = data.data();
+    const size_t n = data.length();
+    size_t i = 0;
+    for ( ; i + 32 <= n ; i += 32)
+    {
+        for (int k = 0 ; k < 4 ; k++)
+        {
+            uint64_t word;
+            memcpy(&word, p + i + 8 * k, 8);
+            lanes[k] = rotate_left(lanes[k] ^ word, 29) * prime;
+        }
+    }
+
+    uint64_t hash = n * prime;
+    for (int k = 0 ; k < 4 ; k++)
+        hash = rotate_left(hash ^ lanes[k], 31) * prime;
+    for ( ; i < n ; i++)
+        hash = (hash ^ (unsigned char) p[i]) * 0x100000001b3ull;
+    return hash ^ (hash >> 32);
+}
+
+bool write_file_atomic(const string &fname, string_view data)
+{
+    const string tmpfname = fname + ".tmp";
+    FILE *fp = fopen(tmpfname.c_str(), "wb");
+    ASSERT(fp != NULL, "Failed to open " << tmpfname << " for writing");
+    if (fp == NULL)
+        return false;
+
+    bool ok = fwrite(data.data(), sizeof(char), data.length(), fp) == data.length();
+    ok = (fclose(fp) == 0) && ok;
+    ASSERT(ok, "Failed to write " << tmpfname);
+    if (!ok)
+    {
+        remove(tmpfname.c_str());
+        return false;
+    }
+
+    return replace_file(tmpfname, fname);
+}
+
+/**
+ * Rename tmpfname over fname, without asserting.
+ */
+bool rename_over(const string &tmpfname, const string &fname)
+{
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows.
+    return MoveFileExA(tmpfname.c_str(), fname.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmpfname.c_str(), fname.c_str()) == 0;
+#endif
+}
+
+bool replace_file(const string &tmpfname, const string &fname)
+{
+    bool ok = rename_over(tmpfname, fname);
+    ASSERT(ok, "Failed to rename " << tmpfname << " to " << fname);
+    return ok;
+}
+
+string unique_tmp_fname(const string &fname)
+{
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%lu.%zx.tmp", process_id(), hash<thread::id>()(this_thread::get_id()));
+    return fname + suffix;
+}
+
+bool try_write_file_atomic(const string &fname, string_view data)
+{
+    const string tmpfname = unique_tmp_fname(fname);
+    FILE *fp = fopen(tmpfname.c_str(), "wb");
+    if (fp == NULL)
+        return false;
+
+    bool ok = fwrite(data.data(), sizeof(char), data.length(), fp) == data.length();
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename_over(tmpfname, fname);
+    if (!ok)
+        remove(tmpfname.c_str());
+    return ok;
+}
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <cassert>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "file_io.hpp"
+
 #ifndef NDEBUG
 #   define ASSERT(condition, message) \
     do { \
@@ -47,7 +53,225 @@ public:
     std::string label;
     std::string str;
     std::string extra_data;
+    int lineno = 0; // line of the label, if read from a STR file. For diagnostics.
+};
+
+std::string unescape_characters(std::string_view s);
+
+/**
+ * False if s has an escape that unescape_characters doesn't know, which it would assert on.
+ */
+bool has_valid_escapes(std::string_view s);
+
+/**
+ * A STR entry that points into the text it was parsed from.
+ * The string is kept as written between the quotes and only unescaped by str().
+ */
+class StrEntryView
+{
+public:
+    std::string_view label;
+    std::string_view raw_str;
+    int lineno = 0; // line of the label, for diagnostics.
+
+    std::string str() const { return unescape_characters(raw_str); }
+};
+
+/**
+ * Bump allocator for strings. Memory is taken in big blocks and only freed all at once,
+ * when the arena goes away.
+ */
+class StringArena
+{
+public:
+    explicit StringArena(size_t block_size = 1 << 20);
+
+    /**
+     * Room for at most n bytes. Only the part handed to commit() is kept,
+     * the rest is reused by the next reserve().
+     */
+    char *reserve(size_t n);
+    std::string_view commit(size_t n);
+
+    std::string_view store(std::string_view s);
+
+    size_t bytes_reserved() const { return total; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_size;
+    char *cur = nullptr;
+    size_t left = 0;
+    size_t total = 0;
+};
+
+/**
+ * Like Entry, but the strings live in the arena of a StringTable.
+ */
+class TableEntry
+{
+public:
+    std::string_view label;
+    std::string_view str;
+    std::string_view extra_data;
+    int lineno = 0;
 };
 
+/**
+ * A whole string table in a handful of big allocations,
+ * instead of three std::strings per entry.
+ */
+class StringTable
+{
+public:
+    StringArena arena;
+    std::vector<TableEntry> entries;
+};
+
+/**
+ * Strings stored back to back in one blob.
+ * String i is blob[offsets[i], offsets[i + 1]).
+ */
+class StringColumn
+{
+public:
+    std::string blob;
+    std::vector<uint32_t> offsets = {0};
+
+    size_t size() const { return offsets.size() - 1; }
+    std::string_view operator[](size_t i) const
+    {
+        return std::string_view(blob.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    void reserve(size_t num_strings, size_t num_bytes);
+    void push_back(std::string_view s);
+
+    /**
+     * Room for the next string of at most n bytes, valid until the next change to the column.
+     * commit() appends its first n bytes as a string.
+     */
+    char *append_space(size_t n);
+    void commit(size_t n);
+};
+
+/**
+ * String table stored as columns. Label-only passes such as lookups and duplicate checks
+ * walk the label blob alone, never the strings or extra data.
+ */
+class ColumnTable
+{
+public:
+    static const uint8_t HAS_EXTRA_DATA = 1;
+
+    StringColumn labels;
+    StringColumn strs;
+    StringColumn extras;
+    std::vector<uint8_t> flags;
+    std::vector<uint32_t> extra_index; // position in extras, valid if HAS_EXTRA_DATA is set.
+    std::vector<int> linenos;
+
+    size_t size() const { return labels.size(); }
+    std::string_view label(size_t i) const { return labels[i]; }
+    std::string_view str(size_t i) const { return strs[i]; }
+    bool has_extra_data(size_t i) const { return flags[i] & HAS_EXTRA_DATA; }
+    std::string_view extra_data(size_t i) const;
+
+    void reserve(size_t num_entries);
+    void push_back(std::string_view label, std::string_view str, int lineno = 0);
+
+    /**
+     * Append an entry whose string was already added to strs, e.g. with strs.append_space().
+     */
+    void push_back(std::string_view label, int lineno = 0);
+
+    void set_extra_data(size_t i, std::string_view extra_data);
+};
+
+/**
+ * Memory-mapped STR file. The entry views are valid as long as this object is.
+ */
+class StrFile
+{
+public:
+    MappedFile file;
+    std::vector<StrEntryView> entries;
+
+    explicit StrFile(const std::string &fname, int num_threads = 1);
+};
+
+/**
+ * Reads a STR file line by line, one entry at a time,
+ * so memory use only depends on the longest line.
+ */
+class StrStreamReader
+{
+public:
+    explicit StrStreamReader(const std::string &fname);
+
+    bool is_open() const { return file.is_open(); }
+
+    /**
+     * Read the next entry with its string unescaped. The strings of entry are reused.
+     * Returns false at the end of the file. A trailing incomplete entry is dropped.
+     */
+    bool next(Entry *entry);
+
+    /**
+     * Same, without unescaping. The views are valid until the next call.
+     */
+    bool next(StrEntryView *entry);
+
+    /**
+     * Where the raw string of the last entry starts in the file, in bytes.
+     */
+    size_t str_offset() const { return raw_str_offset; }
+
+private:
+    std::ifstream file;
+    std::string line;
+    std::string label;
+    std::string raw_str;
+    size_t offset = 0;
+    size_t raw_str_offset = 0;
+    int lineno = 0;
+};
+
+void append_entry_to_str(std::string *out, std::string_view label, std::string_view str, bool is_first);
+void append_entry_to_str(std::string *out, const StrEntryView &entry, bool is_first);
 void write_entry_to_str(FILE *fp, const Entry &entry);
-std::vector<Entry> read_entries(const std::string &fname);
+std::vector<StrEntryView> parse_str_entries(std::string_view text, int num_threads = 1);
+
+/**
+ * Same as parse_str_entries, but returns false instead of asserting when text has a malformed line.
+ * error, if given, receives the message parse_str_entries would assert with.
+ */
+bool try_parse_str_entries(std::string_view text, int num_threads, std::vector<StrEntryView> *entries, std::string *error = nullptr);
+
+/**
+ * Parse the next part of a STR file read block by block, cut at a line end.
+ * Entries still open at the end of text are left out: returns where the first of them starts,
+ * to be parsed again along with the next block. Lines are numbered from first_lineno + 1,
+ * and num_lines receives the number of lines before the returned position.
+ * error receives the message of the first malformed line, or is left empty. Lines of the open
+ * entry only count with last_block, when text is the end of the file and nothing follows.
+ */
+size_t parse_str_block
+(
+    std::string_view text, int first_lineno, bool last_block,
+    std::vector<StrEntryView> *entries, int *num_lines, std::string *error
+);
+std::vector<Entry> read_entries(const std::string &fname, int num_threads = 1);
+void read_entries(const std::string &fname, StringTable *table, int num_threads = 1);
+void append_entries(ColumnTable *table, const std::vector<StrEntryView> &entries, size_t first = 0);
+void read_entries(const std::string &fname, ColumnTable *table, int num_threads = 1);
+
+/**
+ * Number of threads for -j N, where 0 means one per core.
+ */
+int resolve_num_threads(int num_threads);
+
+/**
+ * Call fn(i) for every i in [0, n) on up to num_threads threads, the calling one included.
+ */
+void parallel_for(size_t n, int num_threads, const std::function<void(size_t)> &fn);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "csf_reader.hpp"
+#include "file_io.hpp"
+
+/**
+ * Header of a .csfidx file, the label index written next to a CSF file.
+ * It is followed by num_labels CsfIndexEntry, sorted by label.
+ * The CSF file is identified by its size and checksum; if either changed, the index is stale.
+ */
+struct CsfIndexHeader
+{
+    char magic[4] = {'X', 'D', 'I', 'C'}; // CIDX in reverse, like CSF files do.
+    uint32_t version = 3;
+    uint64_t csf_size;
+    uint64_t csf_checksum;
+    uint32_t num_labels;
+    uint32_t reserved = 0;
+};
+
+struct CsfIndexEntry
+{
+    uint64_t offset; // of the label header in the CSF file.
+    uint32_t label_length;
+    uint32_t number; // position of the label in the CSF file.
+};
+
+/**
+ * Index file contents for the labels of data, sorted by label, then by position.
+ */
+std::string build_csf_index(std::string_view data, const std::vector<CsfEntryRef> &entries);
+
+/**
+ * foo.csf -> foo.csfidx
+ */
+std::string csf_index_fname(const std::string &fname);
+
+/**
+ * Memory-mapped CSF file with its .csfidx, so single labels are found by binary search
+ * without walking the whole file. A missing, stale or damaged index is rebuilt on open,
+ * and saved if the directory allows; an index that can't be saved is only a slower open.
+ * Lookups return positions in label order, from 0 to size().
+ */
+class IndexedCsfFile
+{
+public:
+    MappedFile file;
+    CSFHeader header;
+
+    explicit IndexedCsfFile(const std::string &fname);
+
+    /**
+     * True if the index had to be built when opening.
+     */
+    bool rebuilt() const { return was_rebuilt; }
+
+    size_t size() const { return num_labels; }
+    std::string_view label(size_t k) const;
+    size_t position(size_t k) const { return index_entry(k).number; }
+    CsfEntryRef entry_ref(size_t k) const;
+    std::string str(size_t k) const;
+    std::string_view extra_data(size_t k) const;
+
+    /**
+     * Positions [first, second) of the labels equal to label, in the order they appear in the CSF file.
+     */
+    std::pair<size_t, size_t> equal_range(std::string_view label) const;
+
+    /**
+     * Positions [first, second) of the labels that start with prefix.
+     */
+    std::pair<size_t, size_t> prefix_range(std::string_view prefix) const;
+
+private:
+    bool load_index(const std::string &idxfname);
+    bool check_index_entries() const;
+    const CsfIndexEntry &index_entry(size_t k) const { return entries_begin[k]; }
+    size_t lower_bound(std::string_view label) const;
+    size_t upper_bound(std::string_view label) const;
+    size_t upper_bound_prefix(std::string_view prefix) const;
+
+    MappedFile index_file;
+    std::string built_index; // used instead of index_file when the index was rebuilt.
+    const CsfIndexEntry *entries_begin = nullptr;
+    size_t num_labels = 0;
+    bool was_rebuilt = false;
+};
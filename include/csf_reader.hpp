@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "file_io.hpp"
+
+/**
+ * Position of one label's parts inside a CSF file.
+ * Offsets are in bytes from the start of the file.
+ */
+struct CsfEntryRef
+{
+    size_t label_offset;
+    uint32_t label_length;
+    size_t str_offset;
+    uint32_t str_length; // in UTF-16 code units, not bytes!
+    size_t extra_offset;
+    uint32_t extra_length;
+    bool has_extra_data;
+};
+
+bool parse_csf_header(std::string_view data, CSFHeader *header);
+bool parse_entry(std::string_view data, size_t *pos, CsfEntryRef *ref);
+std::vector<CsfEntryRef> scan_csf_entries(std::string_view data, const CSFHeader &header);
+
+/**
+ * parse_csf_header and scan_csf_entries in one, for data that may not be a CSF file at all.
+ * Returns false instead of asserting on a bad magic or format, a bad label or string header,
+ * or a truncated file. error, if given, receives why.
+ */
+bool try_scan_csf(std::string_view data, CSFHeader *header, std::vector<CsfEntryRef> *entries, std::string *error = nullptr);
+
+/**
+ * Memory-mapped CSF file, or a CSF file already in memory.
+ * Opening it only walks the label and string headers to build the offset table.
+ * Strings are decoded from flipped UTF-16 when asked for.
+ */
+class CsfFile
+{
+public:
+    MappedFile file;
+    std::string_view data; // the whole file, mapped or given by the caller.
+    CSFHeader header;
+    std::vector<CsfEntryRef> entries;
+
+    explicit CsfFile(const std::string &fname);
+
+    /**
+     * Use size bytes at data as the file. They are not copied, so they must outlive this.
+     */
+    CsfFile(const char *data, size_t size);
+
+    std::string_view label(size_t i) const;
+    std::string str(size_t i) const;
+    std::string_view extra_data(size_t i) const;
+    Entry entry(size_t i) const;
+
+    /**
+     * The whole label record as stored in the file, headers and flipped UTF-16 included.
+     */
+    std::string_view raw_entry(size_t i) const;
+
+    /**
+     * Decode all entries into table.
+     */
+    void read_entries(StringTable *table) const;
+    void read_entries(ColumnTable *table) const;
+
+private:
+    void scan(const std::string &name);
+};
+
+/**
+ * One label read by CsfStreamReader. The buffers are reused from label to label.
+ */
+class CsfStreamEntry
+{
+public:
+    std::string label;
+    std::string utf16; // flipped UTF-16, as stored in the file.
+    std::string extra_data;
+    bool has_extra_data = false;
+
+    size_t str_length() const { return utf16.length() / 2; }
+    std::string str() const;
+};
+
+/**
+ * Reads a CSF file front to back through stdio, one label at a time,
+ * so memory use doesn't depend on the size of the file.
+ */
+class CsfStreamReader
+{
+public:
+    CSFHeader header;
+
+    explicit CsfStreamReader(const std::string &fname);
+    ~CsfStreamReader();
+    CsfStreamReader(const CsfStreamReader &) = delete;
+    CsfStreamReader &operator=(const CsfStreamReader &) = delete;
+
+    bool is_open() const { return fp != nullptr; }
+
+    /**
+     * Read the next label into entry.
+     * Returns false after the last one, or if the file ends in the middle of a label.
+     */
+    bool next(CsfStreamEntry *entry);
+
+private:
+    bool read_exact(void *dst, size_t n);
+    bool read_string(std::string *dst, size_t n);
+
+    FILE *fp = nullptr;
+    size_t num_read = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * Size in bytes of the CSF file holding these entries.
+ * utf16_lengths receives the UTF-16 length of each string, to be passed to encode_csf.
+ */
+size_t csf_size(const std::vector<Entry> &entries, std::vector<uint32_t> *utf16_lengths);
+size_t csf_size(const ColumnTable &table, std::vector<uint32_t> *utf16_lengths);
+
+/**
+ * Serialize a whole CSF file into one buffer, allocated once at its final size.
+ * Entries with non-empty extra_data are written as STRW.
+ */
+std::string encode_csf(const CSFHeader &header, const std::vector<Entry> &entries);
+
+/**
+ * Same for a column table, where entries flagged HAS_EXTRA_DATA are written as STRW.
+ */
+std::string encode_csf(const CSFHeader &header, const ColumnTable &table);
+
+/**
+ * Append the label record of one entry, as it goes in a CSF file after the header.
+ * lineno is only for error messages.
+ */
+void append_csf_entry
+(
+    std::string *out,
+    std::string_view label, std::string_view str,
+    bool has_extra_data, std::string_view extra_data,
+    int lineno = 0
+);
+
+/**
+ * Writes a CSF file one entry at a time, so only the current entry is held in memory.
+ * The header goes out first with zero counts and is patched by finish(),
+ * once the number of labels is known. Until then the file is fname.tmp.
+ */
+class CsfStreamWriter
+{
+public:
+    CsfStreamWriter(const std::string &fname, const CSFHeader &header);
+    ~CsfStreamWriter();
+    CsfStreamWriter(const CsfStreamWriter &) = delete;
+    CsfStreamWriter &operator=(const CsfStreamWriter &) = delete;
+
+    bool is_open() const { return fp != nullptr; }
+
+    void write
+    (
+        std::string_view label, std::string_view str,
+        bool has_extra_data, std::string_view extra_data,
+        int lineno = 0
+    );
+
+    /**
+     * Entries with non-empty extra_data are written as STRW.
+     */
+    void write(const Entry &e);
+
+    /**
+     * Write num_entries label records encoded with append_csf_entry.
+     */
+    void write_encoded(std::string_view records, size_t num_entries);
+
+    /**
+     * Patch the header and move the file into place. Returns false if anything failed.
+     */
+    bool finish();
+
+private:
+    std::string fname;
+    std::string tmpfname;
+    FILE *fp = nullptr;
+    CSFHeader header;
+    std::string buffer;
+    bool ok = true;
+};
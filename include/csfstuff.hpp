@@ -0,0 +1,141 @@
+#pragma once
+
+/**
+ * The csfstuff library: what csf2str, str2csf and merge_str do, on buffers instead of files.
+ * Link with the csfstuff target. The lower level pieces are in the headers included below.
+ */
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "csf_reader.hpp"
+#include "csf_writer.hpp"
+#include "str_cache.hpp"
+#include "str_merge.hpp"
+
+/**
+ * The STR text of the CSFSTUFF:META entry for header.
+ */
+std::string header_to_metadata(const CSFHeader &header);
+
+/**
+ * CSF header for num_labels labels from the text of a CSFSTUFF:META entry.
+ * Empty metadata means there was no such entry, and gives the default header with a warning.
+ */
+CSFHeader metadata_to_header(const std::string &metadata, size_t num_labels);
+
+/**
+ * Decode csf into STR text, metadata first, handing it to write piece by piece in order,
+ * so the whole text never has to be in memory. Strings are decoded on num_threads threads.
+ */
+void csf_to_str(const CsfFile &csf, const std::function<void(std::string_view)> &write, int num_threads = 1);
+
+/**
+ * The extra data of csf as json text, laid out like extra_data.json of csf2str.
+ * Empty if no label has extra data.
+ */
+std::string extra_data_to_json(const CsfFile &csf);
+
+/**
+ * Convert a CSF file into a STR file with memory bounded no matter how big the file is.
+ * Strings are decoded on num_threads threads. Extra data goes to extrafname in the order of the CSF file,
+ * and the file is only created if there is some; wrote_extra_data, if given, tells whether it was.
+ * Returns false if the CSF file couldn't be opened.
+ */
+bool stream_csf_file_to_str
+(
+    const std::string &ifname, const std::string &ofname, const std::string &extrafname,
+    int num_threads = 1, bool *wrote_extra_data = nullptr
+);
+
+/**
+ * Decode a CSF file in memory into table.
+ * Returns false, without asserting, if it is not a proper CSF file; see try_scan_csf.
+ */
+bool read_csf(std::string_view csf, CSFHeader *header, ColumnTable *table);
+
+/**
+ * Parse STR text in memory into table, with extra data attached from extra_data_json, which may be empty.
+ * The CSFSTUFF:META entry, if first, goes to header instead of table.
+ */
+void read_str
+(
+    std::string_view str, std::string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table, int num_threads = 1
+);
+
+/**
+ * Same as read_str, but returns false instead of asserting if str is not a proper STR file:
+ * a malformed line, or a string with an unknown escape or invalid UTF-8. error, if given, receives why.
+ * Malformed metadata or extra_data_json still throw, as in read_str.
+ */
+bool try_read_str
+(
+    std::string_view str, std::string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table, int num_threads = 1, std::string *error = nullptr
+);
+
+/**
+ * False if a string of entries has an unknown escape or invalid UTF-8,
+ * which reading or encoding it would assert on. error, if given, receives which and where.
+ */
+bool check_str_strings(const std::vector<StrEntryView> &entries, std::string *error = nullptr);
+
+/**
+ * Same as read_str, for entries already parsed.
+ */
+void read_str_entries
+(
+    const std::vector<StrEntryView> &entries, std::string_view extra_data_json,
+    CSFHeader *header, ColumnTable *table
+);
+
+/**
+ * STR text of table, metadata first. Extra data is left out, see extra_data_to_json.
+ */
+std::string encode_str(const CSFHeader &header, const ColumnTable &table);
+
+/**
+ * Decode a CSF file in memory into STR text.
+ * Extra data goes to extra_data_json, as extra_data_to_json makes it.
+ */
+std::string csf_to_str(std::string_view csf, std::string *extra_data_json, int num_threads = 1);
+
+/**
+ * Encode STR text into a CSF file. extra_data_json may be empty.
+ * The STR text is parsed on num_threads threads.
+ */
+std::string str_to_csf(std::string_view str, std::string_view extra_data_json, int num_threads = 1);
+
+/**
+ * Convert a STR file into a CSF file as a pipeline: one thread reads and parses blocks of the file,
+ * num_threads encode them, and the calling thread writes them in order. Reads, encoding and writes
+ * overlap, and only a bounded number of blocks is in memory. Returns false if writing failed.
+ */
+bool str_file_to_csf(const std::string &ifname, const std::string &ofname, std::string_view extra_data_json, int num_threads = 1);
+
+/**
+ * Convert a STR file into a CSF file one entry at a time, so memory use is bounded by the longest entry
+ * (and extra_data_json, which is in memory already). Returns false if writing failed.
+ */
+bool stream_str_file_to_csf(const std::string &ifname, const std::string &ofname, std::string_view extra_data_json);
+
+/**
+ * Merge parsed STR files into STR text, later ones overwriting earlier ones.
+ */
+std::string merge_str_entries(const std::vector<std::vector<StrEntryView>> &inputs);
+
+/**
+ * Merge STR texts into one, later ones overwriting earlier ones, like merge_str.
+ * The texts are parsed on num_threads threads, several at once.
+ */
+std::string merge_strs(const std::vector<std::string_view> &strs, int num_threads = 1);
+
+/**
+ * Merge STR files into ofname like merge_strs, reading the inputs twice instead of keeping them in memory:
+ * only labels and where their strings are stay in memory.
+ */
+void stream_merge_str_files(const std::vector<std::string> &ifnames, const std::string &ofname);
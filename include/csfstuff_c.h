@@ -0,0 +1,86 @@
+#pragma once
+
+/**
+ * Plain C interface to the csfstuff library, for ctypes and other FFIs.
+ * Link with (or load) the csfstuff_c shared library.
+ *
+ * Files are passed as pointer and size and read in place, so a ctypes caller can hand over
+ * a bytes object without copying it. They are only needed during the call that opens them.
+ * Entries point into memory owned by the table, with strings decoded to UTF-8.
+ * All functions but csfstuff_open_* are safe to call from several threads at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#   define CSFSTUFF_API __declspec(dllexport)
+#else
+#   define CSFSTUFF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct csfstuff_table csfstuff_table;
+
+/**
+ * One entry of a table. Pointers stay valid until the table is freed, and are not NUL-terminated.
+ */
+typedef struct csfstuff_entry
+{
+    const char *label;
+    size_t label_length;
+    const char *str; /* UTF-8 */
+    size_t str_length;
+    const char *extra_data;
+    size_t extra_data_length;
+    int has_extra_data; /* STRW in CSF, even if extra_data is empty. */
+} csfstuff_entry;
+
+/**
+ * Open a CSF file held in memory. Returns NULL if it is not a proper CSF file:
+ * a bad magic or format, a bad label or string header, or fewer labels than the header says.
+ */
+CSFSTUFF_API csfstuff_table *csfstuff_open_csf(const char *data, size_t size);
+
+/**
+ * Open a STR file held in memory, and the extra_data.json that goes with it (may be NULL).
+ * The CSFSTUFF:META entry, if first, becomes the header and is not one of the entries.
+ * Parsed on num_threads threads, 0 meaning one per core.
+ * Returns NULL if it is not a proper STR file (a malformed line, or a string with an unknown
+ * escape or invalid UTF-8), or if the metadata or extra data json is malformed.
+ */
+CSFSTUFF_API csfstuff_table *csfstuff_open_str(
+    const char *data, size_t size,
+    const char *extra_data_json, size_t extra_data_json_size,
+    int num_threads);
+
+CSFSTUFF_API void csfstuff_free_table(csfstuff_table *table);
+
+CSFSTUFF_API size_t csfstuff_size(const csfstuff_table *table);
+CSFSTUFF_API uint32_t csfstuff_lang_code(const csfstuff_table *table);
+
+/**
+ * Fill entry with entry i. Returns 0 if i is out of range.
+ */
+CSFSTUFF_API int csfstuff_get_entry(const csfstuff_table *table, size_t i, csfstuff_entry *entry);
+
+/**
+ * Index of the first entry with the label, or -1.
+ */
+CSFSTUFF_API int64_t csfstuff_find(const csfstuff_table *table, const char *label, size_t label_length);
+
+/**
+ * Encode the table as a CSF or STR file (metadata entry first) into a buffer
+ * allocated with malloc. Free it with csfstuff_free. Returns 0 on failure.
+ */
+CSFSTUFF_API int csfstuff_encode_csf(const csfstuff_table *table, char **out, size_t *out_size);
+CSFSTUFF_API int csfstuff_encode_str(const csfstuff_table *table, char **out, size_t *out_size);
+
+CSFSTUFF_API void csfstuff_free(void *buffer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * Falls back to an empty view when the file can't be opened or is empty.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default; // Not open, empty view.
+    explicit MappedFile(const std::string &fname);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const { return opened; }
+    const char *data() const { return ptr; }
+    size_t size() const { return len; }
+    std::string_view view() const { return std::string_view(ptr, len); }
+
+private:
+    void unmap();
+
+    const char *ptr = nullptr;
+    size_t len = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void *mapping = nullptr;
+#endif
+};
+
+/**
+ * Write data to fname.tmp and rename it over fname, so readers never see a half written file.
+ */
+bool write_file_atomic(const std::string &fname, std::string_view data);
+
+/**
+ * Rename tmpfname over fname, replacing it if it exists.
+ */
+bool replace_file(const std::string &tmpfname, const std::string &fname);
+
+/**
+ * fname with a .tmp suffix of its own to this process and thread,
+ * so that several writers of fname never share a temporary file.
+ */
+std::string unique_tmp_fname(const std::string &fname);
+
+/**
+ * Same as write_file_atomic, through a unique_tmp_fname, and without asserting.
+ * For files that are only worth having, like caches: on failure nothing is written.
+ */
+bool try_write_file_atomic(const std::string &fname, std::string_view data);
+
+bool file_exists(const std::string &fname);
+
+/**
+ * Create dirname unless it exists; its parent must exist. Returns true if it is there afterwards.
+ */
+bool make_directory(const std::string &dirname);
+
+/**
+ * Fast 64 bit checksum, to tell whether a file changed. Not meant to resist tampering.
+ */
+uint64_t checksum_bytes(std::string_view data);
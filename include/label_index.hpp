@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+uint64_t hash_label(std::string_view label);
+
+/**
+ * Open addressing (linear probing) hash table from label to an index.
+ * Labels are stored as string_views along with their hash,
+ * so whatever they point into must outlive the index.
+ */
+class LabelIndex
+{
+public:
+    static const uint32_t NOT_FOUND = UINT32_MAX;
+
+    explicit LabelIndex(size_t expected_size = 0);
+
+    /**
+     * Returns the value of label, or NOT_FOUND.
+     */
+    uint32_t find(std::string_view label) const;
+
+    /**
+     * Maps label to value, unless label is already there.
+     * Returns the value that was already there, or NOT_FOUND if value got inserted.
+     */
+    uint32_t insert(std::string_view label, uint32_t value);
+
+    /**
+     * Maps label to value, replacing whatever was there.
+     */
+    void assign(std::string_view label, uint32_t value);
+
+    size_t size() const { return count; }
+
+private:
+    struct Slot
+    {
+        uint64_t hash;
+        std::string_view label;
+        uint32_t value = NOT_FOUND; // NOT_FOUND marks an empty slot.
+    };
+
+    size_t probe(std::string_view label, uint64_t hash) const;
+    void grow();
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+};
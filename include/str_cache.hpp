@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "file_io.hpp"
+
+/**
+ * Header of a .strcache file, the parsed entries of one STR file kept in a cache directory.
+ * It is followed by num_entries StrCacheEntry, in file order.
+ * Cache files are named after the checksum of the STR file, so any STR file with
+ * the same contents shares it, wherever it is and whatever it is called.
+ */
+struct StrCacheHeader
+{
+    char magic[4] = {'C', 'R', 'T', 'S'}; // STRC in reverse, like CSF files do.
+    uint32_t version = 2;
+    uint64_t str_size;
+    uint64_t str_checksum;
+    uint64_t num_entries;
+    uint64_t entries_checksum; // of the StrCacheEntry records, which the STR checksum doesn't cover.
+};
+
+/**
+ * Where the parts of one entry are in the STR file. The string is still escaped, see StrEntryView.
+ */
+struct StrCacheEntry
+{
+    uint64_t label_offset;
+    uint64_t raw_str_offset;
+    uint32_t label_length;
+    uint32_t raw_str_length;
+    int32_t lineno;
+    uint32_t reserved = 0;
+};
+
+std::string str_cache_fname(const std::string &cache_dir, uint64_t str_checksum);
+
+/**
+ * Memory-mapped STR file whose entries come from cache_dir if it has them.
+ * The constructor only maps the file and checksums it, so the checksum can key other caches first.
+ * read_entries then fills entries: from the cache, or else by parsing the file as StrFile does
+ * and saving the entries to cache_dir for next time, if they can be: the cache never fails the caller.
+ * With an empty cache_dir, this is just a StrFile.
+ */
+class CachedStrFile
+{
+public:
+    MappedFile file;
+    uint64_t checksum = 0; // of file, if there is a cache_dir.
+    std::vector<StrEntryView> entries;
+
+    CachedStrFile(const std::string &fname, const std::string &cache_dir);
+
+    void read_entries(int num_threads = 1);
+
+    bool cache_hit() const { return hit; }
+
+private:
+    bool load_cache(const std::string &cachefname);
+    void save_cache(const std::string &cachefname) const;
+
+    std::string cache_dir;
+    bool hit = false;
+};
+
+/**
+ * Header of a .out file, the whole output of a tool kept in a cache directory.
+ * It is followed by size bytes of output. Cache files are named after key, see output_cache_key.
+ */
+struct OutputCacheHeader
+{
+    char magic[4] = {'T', 'U', 'O', 'C'}; // COUT in reverse, like CSF files do.
+    uint32_t version = 1;
+    uint64_t key;
+    uint64_t size;
+    uint64_t checksum; // of the output.
+};
+
+/**
+ * Key for the output of tool made from inputs with the given checksums, in order.
+ */
+uint64_t output_cache_key(std::string_view tool, const std::vector<uint64_t> &checksums);
+
+std::string output_cache_fname(const std::string &cache_dir, uint64_t key);
+
+/**
+ * Output kept in cache_dir under key, if it is there and intact; data is valid while this lives.
+ * On a miss, save stores the output computed instead, if it can: like CachedStrFile, it never fails the caller.
+ */
+class CachedOutput
+{
+public:
+    std::string_view data;
+
+    CachedOutput(const std::string &cache_dir, uint64_t key);
+
+    bool cache_hit() const { return hit; }
+
+    void save(std::string_view output) const;
+
+private:
+    MappedFile file;
+    std::string cache_dir;
+    std::string cachefname;
+    uint64_t key;
+    bool hit = false;
+};
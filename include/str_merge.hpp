@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "label_index.hpp"
+
+/**
+ * The merge result. Views point into the input files, which must be kept open until written.
+ */
+class MergedEntries
+{
+public:
+    std::vector<StrEntryView> entries;
+    std::vector<uint32_t> sources; // which input file each entry got its string from
+    LabelIndex lut; // label -> index into entries
+};
+
+/**
+ * What a label does to the merge.
+ */
+enum merge_action_t
+{
+    APPEND, // a new label, appended to the end.
+    REPLACE, // existing is overwritten.
+};
+
+/**
+ * Apply the merge rules to label of source, updating lut, where next is the index a new entry would get.
+ * Duplicate labels within one source are caught in the same pass:
+ * the existing entry would have been set by the very same source.
+ * If APPEND is returned, lut keeps the label view, so it must stay valid.
+ */
+merge_action_t merge_label
+(
+    LabelIndex *lut, const std::vector<uint32_t> &sources,
+    std::string_view label, uint32_t source, uint32_t next, uint32_t *existing
+);
+
+/**
+ * Replace overlapping entries on top of merged, from new_entries.
+ * Non-overlapping entries will be appended.
+ */
+void merge_entries(MergedEntries *merged, const std::vector<StrEntryView> &new_entries, uint32_t source);
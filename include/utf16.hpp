@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * CSF strings are stored as little endian UTF-16 with every bit inverted.
+ * These kernels undo (or apply) the inversion while transcoding, in one pass.
+ *
+ * The widest instruction set supported by the CPU is picked at run time.
+ * Pass a SimdLevel explicitly to force a narrower one, e.g. for benchmarking.
+ */
+enum class SimdLevel
+{
+    SCALAR,
+    SSE41,
+    AVX2,
+};
+
+SimdLevel detect_simd_level();
+const char *simd_level_name(SimdLevel level);
+
+/**
+ * Decode n flipped UTF-16 code units at p into UTF-8.
+ * Unpaired surrogates become U+FFFD.
+ */
+std::string flipped_utf16_to_utf8(const char *p, size_t n);
+std::string flipped_utf16_to_utf8(const char *p, size_t n, SimdLevel level);
+
+/**
+ * Same as above, into out, which needs room for 3 * n bytes.
+ * (A code unit never takes more than 3 UTF-8 bytes, a surrogate pair takes 4 for 2 units.)
+ * Returns the number of bytes written.
+ */
+size_t flipped_utf16_to_utf8(const char *p, size_t n, char *out);
+size_t flipped_utf16_to_utf8(const char *p, size_t n, char *out, SimdLevel level);
+
+/**
+ * Number of UTF-16 code units utf8_to_flipped_utf16() produces for s.
+ */
+size_t utf16_length(std::string_view s);
+
+/**
+ * Encode UTF-8 s as flipped UTF-16 into out, which needs room for 2 * s.length() bytes.
+ * Returns the number of code units written.
+ * Malformed sequences become U+FFFD. *error_offset gets the byte offset of the first one,
+ * or std::string_view::npos if s is valid UTF-8.
+ */
+size_t utf8_to_flipped_utf16(std::string_view s, char *out, size_t *error_offset);
+size_t utf8_to_flipped_utf16(std::string_view s, char *out, size_t *error_offset, SimdLevel level);
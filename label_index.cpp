@@ -0,0 +1,100 @@
+#include "include/label_index.hpp"
+
+using namespace std;
+
+/**
+ * 64 bit FNV-1a. Labels are short, so this is as good as anything fancier.
+ */
+uint64_t hash_label(string_view label)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char ch: label)
+    {
+        hash ^= (unsigned char) ch;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+LabelIndex::LabelIndex(size_t expected_size)
+{
+    // Keep the load factor under 1/2.
+    size_t capacity = 16;
+    while (capacity < 2 * expected_size)
+        capacity *= 2;
+    slots.resize(capacity);
+}
+
+/**
+ * Index of the slot holding label, or of the empty slot where it would go.
+ */
+size_t LabelIndex::probe(string_view label, uint64_t hash) const
+{
+    const size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (true)
+    {
+        const Slot &slot = slots[i];
+        if (slot.value == NOT_FOUND)
+            return i;
+        if (slot.hash == hash && slot.label == label)
+            return i;
+        i = (i + 1) & mask;
+    }
+}
+
+uint32_t LabelIndex::find(string_view label) const
+{
+    return slots[probe(label, hash_label(label))].value;
+}
+
+uint32_t LabelIndex::insert(string_view label, uint32_t value)
+{
+    if (2 * (count + 1) > slots.size())
+        grow();
+
+    const uint64_t hash = hash_label(label);
+    Slot &slot = slots[probe(label, hash)];
+    if (slot.value != NOT_FOUND)
+        return slot.value;
+
+    slot.hash = hash;
+    slot.label = label;
+    slot.value = value;
+    count++;
+    return NOT_FOUND;
+}
+
+void LabelIndex::assign(string_view label, uint32_t value)
+{
+    if (2 * (count + 1) > slots.size())
+        grow();
+
+    const uint64_t hash = hash_label(label);
+    Slot &slot = slots[probe(label, hash)];
+    if (slot.value == NOT_FOUND)
+    {
+        slot.hash = hash;
+        slot.label = label;
+        count++;
+    }
+    slot.value = value;
+}
+
+void LabelIndex::grow()
+{
+    vector<Slot> old(2 * slots.size());
+    old.swap(slots);
+
+    // Hashes are kept, so no label is hashed again.
+    const size_t mask = slots.size() - 1;
+    for (const Slot &slot: old)
+    {
+        if (slot.value == NOT_FOUND)
+            continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].value != NOT_FOUND)
+            i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * A program to merge multiple CSF files into one, without going through STR files.
+ * Label records are copied from the inputs as they are, so strings are never
+ * converted from UTF-16 and extra data is kept as it is.
+ */
+
+#include <vector>
+#include <string>
+#include "include/common.hpp"
+#include "include/csf_reader.hpp"
+#include "include/label_index.hpp"
+
+using namespace std;
+
+void show_usage()
+{
+    cout << "Usage: merge_csf input1.csf input2.csf ... inputN.csf output.csf" << endl;
+    cout << endl;
+    cout << "    Merges multiple CSF files into one." << endl;
+    cout << "    The last command line argument specifies the output CSF file." << endl;
+    cout << "    Later CSF files will overwrite onto earlier ones." << endl;
+    cout << "    That is, input1.csf has the lowest priority." << endl;
+    cout << "    The language code comes from the last file, like CSFSTUFF:META does with merge_str." << endl;
+}
+
+/**
+ * Where the winning record of a label is: entry index of an input file.
+ */
+struct CsfRecordRef
+{
+    uint32_t source;
+    uint32_t index;
+};
+
+/**
+ * The merge result. Labels in lut point into the input files, which must be kept open until written.
+ */
+class MergedRecords
+{
+public:
+    vector<CsfRecordRef> records;
+    LabelIndex lut; // label -> index into records
+};
+
+/**
+ * Same rules as merge_entries() of merge_str:
+ * overlapping labels take the record of the later file, others are appended.
+ */
+void merge_records(MergedRecords *merged, const CsfFile &csf, uint32_t source)
+{
+    for (uint32_t i = 0 ; i < csf.entries.size() ; i++)
+    {
+        const string_view label = csf.label(i);
+        const CsfRecordRef ref = {source, i};
+        uint32_t existing = merged->lut.insert(label, merged->records.size());
+        if (existing == LabelIndex::NOT_FOUND)
+        {
+            merged->records.push_back(ref);
+        }
+        else if (merged->records[existing].source == source && source == 0)
+        {
+            ASSERT(0, "\nDuplicate entry found, label is " << label);
+            // Without asserts, keep both like the primary file has them. Later files overwrite the last one.
+            merged->lut.assign(label, merged->records.size());
+            merged->records.push_back(ref);
+        }
+        else
+        {
+            ASSERT(merged->records[existing].source != source, "\nDuplicate entry found, label is " << label);
+            merged->records[existing] = ref;
+        }
+    }
+}
+
+/**
+ * Everything is copied into one buffer of the final size, then written at once.
+ * The header is the one of the last file, which wins like any other label would.
+ */
+void write_records(const string &ofname, const vector<CsfFile> &inputs, const vector<CsfRecordRef> &records)
+{
+    CSFHeader header = inputs.back().header;
+    header.num_labels = header.num_strings = records.size();
+
+    size_t size = sizeof(CSFHeader);
+    for (const CsfRecordRef &ref: records)
+        size += inputs[ref.source].raw_entry(ref.index).length();
+
+    string buffer;
+    buffer.reserve(size);
+    buffer.append((const char *) &header, sizeof(CSFHeader));
+    for (const CsfRecordRef &ref: records)
+        buffer.append(inputs[ref.source].raw_entry(ref.index));
+
+    write_file_atomic(ofname, buffer);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        show_usage();
+        return 0;
+    }
+    if (argc < 4)
+    {
+        cout << "You only specified one input file, nothing to merge." << endl;
+        return 0;
+    }
+
+    const string ofname = argv[argc - 1];
+    const size_t num_inputs = argc - 2;
+
+    // The merged records point into the input files, so all of them stay mapped until the end.
+    vector<CsfFile> inputs;
+    inputs.reserve(num_inputs);
+
+    MergedRecords merged;
+    for (size_t i = 0 ; i < num_inputs ; i++)
+    {
+        const string ifname = argv[i + 1];
+        ASSERT(ifname != ofname, "Input and output file names must have different file names");
+        if (i == 0)
+            cout << "Primary file is " << ifname << endl;
+        else
+            cout << "Merging " << ifname << endl;
+
+        inputs.emplace_back(ifname);
+        merge_records(&merged, inputs.back(), i);
+    }
+
+    write_records(ofname, inputs, merged.records);
+    cout << "Merged as " << ofname << endl;
+    return 0;
+}
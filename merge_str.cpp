@@ -4,104 +4,126 @@
  * without dedicated tools. Hence STR merging would be much better.
  */
 
+#include <algorithm>
+#include <memory>
 #include <vector>
-#include <map>
 #include <string>
-#include "include/common.hpp"
+#include "include/csfstuff.hpp"
 
 using namespace std;
 
 void show_usage()
 {
-    cout << "Usage: merge_str input1.str input2.str ... inputN.str output.str" << endl;
+    cout << "Usage: merge_str [-j N] [--stream] [--cache DIR] input1.str input2.str ... inputN.str output.str" << endl;
     cout << endl;
     cout << "    Merges multiple STR files into one." << endl;
     cout << "    The last command line argument specifies the output STR file." << endl;
     cout << "    Later STR files will overwrite onto earlier ones." << endl;
     cout << "    That is, input1.str has the lowest priority." << endl;
+    cout << "    -j N parses the STR files on N threads, several files at once. 0 means one per core. Default is 1." << endl;
+    cout << "    --stream reads the inputs twice instead of keeping them in memory." << endl;
+    cout << "             Only labels and where their strings are stay in memory." << endl;
+    cout << "    --cache DIR keeps the parsed STR files and the output in DIR, so unchanged ones aren't parsed again." << endl;
 }
 
-/**
- * Create the map so thate we can find where the overlapping entries are
- * in the destination entries.
- */
-map<string, int> make_lookup_table(const vector<Entry> &entries)
-{
-    map<string, int> result;
-    for (size_t i = 0 ; i < entries.size() ; i++)
-    {
-        const string &label = entries[i].label;
-        auto it = result.find(label);
-        ASSERT(it == result.end(), "\nDuplicate entry found, label is " << label);
-        result[label] = i;
-    }
-    return result;
-}
-
-/**
- * Replace overlapping entries on top of main_entries, from main_entries.
- * Non-overlapping entries will be appended.
- *
- * lut: [inout] lookup table.
- */
-void merge_entries(vector<Entry> *main_entries, const vector<Entry> &new_entries, map<string, int> *lut)
+int main(int argc, const char *argv[])
 {
-    for (const Entry &e: new_entries)
+    // File names, with options taken out.
+    vector<string> args;
+    int num_threads = 1;
+    bool stream = false;
+    string cache_dir;
+    for (int i = 1 ; i < argc ; i++)
     {
-        auto it = lut->find(e.label);
-        if (it == lut->end())
-        {
-            // Non-overlapping entry. Just append to main entries.
-            (*lut)[e.label] = main_entries->size();
-            main_entries->push_back(e);
-        }
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+            num_threads = resolve_num_threads(atoi(argv[++i]));
+        else if (arg == "--stream")
+            stream = true;
+        else if (arg == "--cache" && i + 1 < argc)
+            cache_dir = argv[++i];
         else
-        {
-            Entry &existing = main_entries->at(it->second);
-            existing.str = e.str;
-        }
+            args.push_back(arg);
     }
-}
 
-void write_entries_to_str(const string &ofname, const vector<Entry> &entries)
-{
-    FILE *fp = fopen(ofname.c_str(), "w");
-    for (const Entry &e: entries)
-        write_entry_to_str(fp, e);
-    fclose(fp);
-}
-
-int main(int argc, const char *argv[])
-{
-    if (argc < 3)
+    if (args.size() < 2)
     {
         show_usage();
         return 0;
     }
-    if (argc < 4)
+    if (args.size() < 3)
     {
         cout << "You only specified one input file, nothing to merge." << endl;
         return 0;
     }
 
-    const char *ofname = argv[argc - 1];
-    cout << "Primary file is " << argv[1] << endl;
-    vector<Entry> main_entries = read_entries(argv[1]);
+    const string &ofname = args.back();
+    const size_t num_inputs = args.size() - 1;
 
-    // to merge the STR entries while preserving order of entry appearance, we need to create a lookup table
-    map<string, int> lut = make_lookup_table(main_entries);
+    if (stream)
+    {
+        for (size_t i = 0 ; i < num_inputs ; i++)
+            cout << (i == 0 ? "Primary file is " : "Merging ") << args[i] << endl;
 
-    for (size_t i = 2 ; i < argc - 1 ; i++)
+        stream_merge_str_files(vector<string>(args.begin(), args.end() - 1), ofname);
+        cout << "Merged as " << ofname << endl;
+        return 0;
+    }
+
+    if (!cache_dir.empty())
     {
-        cout << "On file \"" << argv[i] << "\"" << endl;
-        vector<Entry> more_entries = read_entries(argv[i]);
-        map<string, int> _lut = make_lookup_table(more_entries); // Just to check for duplicate entries in more_entries
+        for (size_t i = 0 ; i < num_inputs ; i++)
+            cout << (i == 0 ? "Primary file is " : "Merging ") << args[i] << endl;
+
+        // Unchanged inputs, in the same order, merge into the same output as last time.
+        vector<unique_ptr<CachedStrFile>> files(num_inputs);
+        vector<uint64_t> checksums(num_inputs);
+        parallel_for(num_inputs, num_threads, [&](size_t i)
+        {
+            files[i] = make_unique<CachedStrFile>(args[i], cache_dir);
+            checksums[i] = files[i]->checksum;
+        });
+        const CachedOutput cached(cache_dir, output_cache_key("merge_str", checksums));
 
-        cout << "Merging " << argv[i] << endl;
-        merge_entries(&main_entries, more_entries, &lut);
+        // Otherwise same as merge_strs, except that each file is parsed only if the cache doesn't have it.
+        string merged;
+        string_view output = cached.data;
+        if (!cached.cache_hit())
+        {
+            vector<vector<StrEntryView>> inputs(num_inputs);
+            const int threads_per_input = max<int>(1, num_threads / num_inputs);
+            parallel_for(num_inputs, num_threads, [&](size_t i)
+            {
+                files[i]->read_entries(threads_per_input);
+                inputs[i] = move(files[i]->entries);
+            });
+            merged = merge_str_entries(inputs);
+            cached.save(merged);
+            output = merged;
+        }
+
+        FILE *fp = fopen(ofname.c_str(), "w");
+        fwrite(output.data(), sizeof(char), output.length(), fp);
+        fclose(fp);
+        cout << "Merged as " << ofname << endl;
+        return 0;
     }
 
-    write_entries_to_str(ofname, main_entries);
+    // The merged entries point into the input files, so all of them stay mapped until the end.
+    vector<MappedFile> inputs;
+    vector<string_view> strs;
+    inputs.reserve(num_inputs);
+    for (size_t i = 0 ; i < num_inputs ; i++)
+    {
+        cout << (i == 0 ? "Primary file is " : "Merging ") << args[i] << endl;
+        inputs.emplace_back(args[i]);
+        strs.push_back(inputs.back().view());
+    }
+
+    const string merged = merge_strs(strs, num_threads);
+    FILE *fp = fopen(ofname.c_str(), "w");
+    fwrite(merged.data(), sizeof(char), merged.length(), fp);
+    fclose(fp);
     cout << "Merged as " << ofname << endl;
     return 0;
 }
@@ -0,0 +1,187 @@
+/**
+ * Cache of parsed STR files, so that unchanged inputs are not parsed again.
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "include/str_cache.hpp"
+
+using namespace std;
+
+string str_cache_fname(const string &cache_dir, uint64_t str_checksum)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.strcache", (unsigned long long) str_checksum);
+    return cache_dir + "/" + name;
+}
+
+CachedStrFile::CachedStrFile(const string &fname, const string &cache_dir):
+    file(fname),
+    cache_dir(cache_dir)
+{
+    if (!cache_dir.empty())
+        checksum = checksum_bytes(file.view());
+}
+
+void CachedStrFile::read_entries(int num_threads)
+{
+    if (cache_dir.empty())
+    {
+        entries = parse_str_entries(file.view(), num_threads);
+        return;
+    }
+
+    const string cachefname = str_cache_fname(cache_dir, checksum);
+    if (file_exists(cachefname) && load_cache(cachefname))
+    {
+        hit = true;
+        return;
+    }
+
+    entries = parse_str_entries(file.view(), num_threads);
+    if (make_directory(cache_dir))
+        save_cache(cachefname);
+}
+
+/**
+ * Rebuild the entry views from the cache file, if it belongs to the STR file as it is now.
+ * The records must match their checksum, and every entry must lie within the STR file,
+ * so a damaged cache is only a miss.
+ */
+bool CachedStrFile::load_cache(const string &cachefname)
+{
+    const MappedFile cache(cachefname);
+    const string_view data = cache.view();
+
+    StrCacheHeader expected;
+    StrCacheHeader header;
+    if (data.length() < sizeof(StrCacheHeader))
+        return false;
+    memcpy(&header, data.data(), sizeof(StrCacheHeader));
+
+    bool ok = memcmp(header.magic, expected.magic, 4) == 0
+        && header.version == expected.version
+        && header.str_size == file.size()
+        && header.str_checksum == checksum
+        // Divided first, so that a damaged count can't overflow into a matching size.
+        && header.num_entries <= (data.length() - sizeof(StrCacheHeader)) / sizeof(StrCacheEntry)
+        && data.length() == sizeof(StrCacheHeader) + header.num_entries * sizeof(StrCacheEntry);
+    if (!ok || header.entries_checksum != checksum_bytes(data.substr(sizeof(StrCacheHeader))))
+        return false;
+
+    const StrCacheEntry *cached = (const StrCacheEntry *) (data.data() + sizeof(StrCacheHeader));
+    const string_view text = file.view();
+    entries.resize(header.num_entries);
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const StrCacheEntry &c = cached[i];
+        if (c.label_offset > text.length() || c.label_length > text.length() - c.label_offset
+            || c.raw_str_offset > text.length() || c.raw_str_length > text.length() - c.raw_str_offset)
+        {
+            entries.clear();
+            return false;
+        }
+        entries[i].label = text.substr(c.label_offset, c.label_length);
+        entries[i].raw_str = text.substr(c.raw_str_offset, c.raw_str_length);
+        entries[i].lineno = c.lineno;
+    }
+    return true;
+}
+
+/**
+ * Empty views from malformed entries may point nowhere.
+ */
+uint64_t offset_in(string_view text, string_view part)
+{
+    return part.empty() ? 0 : part.data() - text.data();
+}
+
+void CachedStrFile::save_cache(const string &cachefname) const
+{
+    StrCacheHeader header;
+    header.str_size = file.size();
+    header.str_checksum = checksum;
+    header.num_entries = entries.size();
+
+    vector<StrCacheEntry> cached(entries.size());
+    for (size_t i = 0 ; i < entries.size() ; i++)
+    {
+        const StrEntryView &e = entries[i];
+        cached[i].label_offset = offset_in(file.view(), e.label);
+        cached[i].label_length = e.label.length();
+        cached[i].raw_str_offset = offset_in(file.view(), e.raw_str);
+        cached[i].raw_str_length = e.raw_str.length();
+        cached[i].lineno = e.lineno;
+    }
+
+    const string_view records((const char *) cached.data(), cached.size() * sizeof(StrCacheEntry));
+    header.entries_checksum = checksum_bytes(records);
+
+    string result;
+    result.reserve(sizeof(StrCacheHeader) + records.length());
+    result.append((const char *) &header, sizeof(StrCacheHeader));
+    result.append(records);
+    // Several processes, or threads of merge_str given the same contents twice, may save this at once.
+    // Whichever rename comes last wins, and a failure only means parsing again next time.
+    try_write_file_atomic(cachefname, result);
+}
+
+uint64_t output_cache_key(string_view tool, const vector<uint64_t> &checksums)
+{
+    string key_data(tool);
+    key_data.append((const char *) checksums.data(), checksums.size() * sizeof(uint64_t));
+    return checksum_bytes(key_data);
+}
+
+string output_cache_fname(const string &cache_dir, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.out", (unsigned long long) key);
+    return cache_dir + "/" + name;
+}
+
+/**
+ * The output is checksummed again, so a damaged cache file is only a miss.
+ */
+CachedOutput::CachedOutput(const string &cache_dir, uint64_t key):
+    cache_dir(cache_dir),
+    cachefname(output_cache_fname(cache_dir, key)),
+    key(key)
+{
+    if (!file_exists(cachefname))
+        return;
+    file = MappedFile(cachefname);
+    const string_view contents = file.view();
+
+    OutputCacheHeader expected;
+    OutputCacheHeader header;
+    if (contents.length() < sizeof(OutputCacheHeader))
+        return;
+    memcpy(&header, contents.data(), sizeof(OutputCacheHeader));
+
+    const string_view output = contents.substr(sizeof(OutputCacheHeader));
+    hit = memcmp(header.magic, expected.magic, 4) == 0
+        && header.version == expected.version
+        && header.key == key
+        && header.size == output.length()
+        && header.checksum == checksum_bytes(output);
+    if (hit)
+        data = output;
+}
+
+void CachedOutput::save(string_view output) const
+{
+    if (!make_directory(cache_dir))
+        return;
+
+    OutputCacheHeader header;
+    header.key = key;
+    header.size = output.length();
+    header.checksum = checksum_bytes(output);
+
+    string result;
+    result.reserve(sizeof(OutputCacheHeader) + output.length());
+    result.append((const char *) &header, sizeof(OutputCacheHeader));
+    result.append(output);
+    try_write_file_atomic(cachefname, result);
+}
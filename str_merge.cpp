@@ -0,0 +1,47 @@
+/**
+ * Merge rules shared by merge_str's in-memory and streaming modes.
+ */
+#include "include/str_merge.hpp"
+
+using namespace std;
+
+merge_action_t merge_label
+(
+    LabelIndex *lut, const vector<uint32_t> &sources,
+    string_view label, uint32_t source, uint32_t next, uint32_t *existing
+)
+{
+    *existing = lut->insert(label, next);
+    if (*existing == LabelIndex::NOT_FOUND)
+        return APPEND;
+
+    if (sources[*existing] == source && source == 0)
+    {
+        ASSERT(0, "\nDuplicate entry found, label is " << label);
+        // Without asserts, keep both like the primary file has them. Later files overwrite the last one.
+        lut->assign(label, next);
+        return APPEND;
+    }
+
+    ASSERT(sources[*existing] != source, "\nDuplicate entry found, label is " << label);
+    return REPLACE;
+}
+
+void merge_entries(MergedEntries *merged, const vector<StrEntryView> &new_entries, uint32_t source)
+{
+    for (const StrEntryView &e: new_entries)
+    {
+        uint32_t existing;
+        switch (merge_label(&merged->lut, merged->sources, e.label, source, merged->entries.size(), &existing))
+        {
+            case APPEND:
+                merged->entries.push_back(e);
+                merged->sources.push_back(source);
+                break;
+            case REPLACE:
+                merged->entries[existing].raw_str = e.raw_str;
+                merged->sources[existing] = source;
+                break;
+        }
+    }
+}
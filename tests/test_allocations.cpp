@@ -0,0 +1,143 @@
+/**
+ * Counts heap allocations per entry along the read -> write paths,
+ * so that copies of whole entries don't sneak back in.
+ * Run by ctest, or by hand from any writable directory.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/common.hpp"
+#include "../include/csf_reader.hpp"
+#include "../include/csf_writer.hpp"
+
+using namespace std;
+
+atomic<size_t> num_allocations(0);
+
+void *operator new(size_t size)
+{
+    num_allocations++;
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+const size_t NUM_ENTRIES = 10000;
+
+/**
+ * Labels and strings are longer than the small string optimization buffer,
+ * so each of them really costs an allocation when copied.
+ */
+string make_str_file()
+{
+    string text;
+    for (size_t i = 0 ; i < NUM_ENTRIES ; i++)
+    {
+        text += "TEST:LABEL_NUMBER_" + to_string(i) + "\n";
+        text += "\"String number " + to_string(i) + ", long enough\\nto live on the heap\"\n";
+        text += "END\n\n";
+    }
+    return text;
+}
+
+bool check(const char *what, size_t allocations, double max_per_entry)
+{
+    double per_entry = (double) allocations / NUM_ENTRIES;
+    bool ok = per_entry <= max_per_entry;
+    printf("%-12s %8zu allocations, %.3f per entry (max %.3f) %s\n",
+        what, allocations, per_entry, max_per_entry, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    const string strfname = "test_allocations.str";
+    const string csffname = "test_allocations.csf";
+    bool ok = true;
+
+    {
+        string text = make_str_file();
+        write_file_atomic(strfname, text);
+    }
+
+    // STR -> CSF, like str2csf: one allocation for the label and one for the string.
+    {
+        size_t before = num_allocations;
+        vector<Entry> entries = read_entries(strfname);
+        CSFHeader header;
+        header.num_labels = header.num_strings = entries.size();
+        header.unused = header.lang_code = 0;
+        string csf = encode_csf(header, entries);
+        ok = check("str -> csf", num_allocations - before, 2.01) && ok;
+        ok = ok && entries.size() == NUM_ENTRIES;
+        write_file_atomic(csffname, csf);
+    }
+
+    // CSF -> STR, like csf2str: one allocation for the decoded string.
+    {
+        size_t before = num_allocations;
+        CsfFile csf(csffname);
+        string out;
+        for (size_t i = 0 ; i < csf.entries.size() ; i++)
+            append_entry_to_str(&out, csf.label(i), csf.str(i), i == 0);
+        ok = check("csf -> str", num_allocations - before, 1.01) && ok;
+        ok = ok && csf.entries.size() == NUM_ENTRIES;
+    }
+
+    // STR -> STR through views, like merge_str: no allocation per entry at all.
+    {
+        size_t before = num_allocations;
+        StrFile strf(strfname);
+        string out;
+        for (size_t i = 0 ; i < strf.entries.size() ; i++)
+            append_entry_to_str(&out, strf.entries[i], i == 0);
+        ok = check("str -> str", num_allocations - before, 0.01) && ok;
+        ok = ok && strf.entries.size() == NUM_ENTRIES;
+    }
+
+    // Arena-backed tables: a few blocks for the whole file.
+    {
+        size_t before = num_allocations;
+        StringTable table;
+        read_entries(strfname, &table);
+        ok = check("str -> table", num_allocations - before, 0.01) && ok;
+        ok = ok && table.entries.size() == NUM_ENTRIES;
+    }
+    {
+        size_t before = num_allocations;
+        CsfFile csf(csffname);
+        StringTable table;
+        csf.read_entries(&table);
+        ok = check("csf -> table", num_allocations - before, 0.01) && ok;
+        ok = ok && table.entries.size() == NUM_ENTRIES && table.entries[7].str == csf.str(7);
+    }
+
+    // Column tables: a handful of growing blobs and offset arrays.
+    {
+        size_t before = num_allocations;
+        CsfFile csf(csffname);
+        ColumnTable table;
+        csf.read_entries(&table);
+        ok = check("csf -> cols", num_allocations - before, 0.01) && ok;
+        ok = ok && table.size() == NUM_ENTRIES && table.str(7) == csf.str(7) && table.label(7) == csf.label(7);
+    }
+
+    remove(strfname.c_str());
+    remove(csffname.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+"""
+After building the project, you can run python nosetests.
+Just install nosetests then run nosetest command to run the tests.
+
+These load the csfstuff_c library with ctypes instead of running the tools.
+"""
+
+import ctypes
+import json
+import os
+import sys
+import tempfile
+from pathlib import Path
+
+ORIGINAL_CWD = Path(os.getcwd())
+CSF2STR = Path("build/csf2str").absolute()
+STR2CSF = Path("build/str2csf").absolute()
+if sys.platform == "win32":
+    LIBCSFSTUFF = Path("build/csfstuff_c.dll").absolute()
+elif sys.platform == "darwin":
+    LIBCSFSTUFF = Path("build/libcsfstuff_c.dylib").absolute()
+else:
+    LIBCSFSTUFF = Path("build/libcsfstuff_c.so").absolute()
+assert LIBCSFSTUFF.exists(), "csfstuff_c is not compiled."
+
+
+class Entry(ctypes.Structure):
+    _fields_ = [
+        ("label", ctypes.c_void_p),
+        ("label_length", ctypes.c_size_t),
+        ("str", ctypes.c_void_p),
+        ("str_length", ctypes.c_size_t),
+        ("extra_data", ctypes.c_void_p),
+        ("extra_data_length", ctypes.c_size_t),
+        ("has_extra_data", ctypes.c_int),
+    ]
+
+
+def load_library():
+    lib = ctypes.CDLL(str(LIBCSFSTUFF))
+    lib.csfstuff_open_csf.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.csfstuff_open_csf.restype = ctypes.c_void_p
+    lib.csfstuff_open_str.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_int]
+    lib.csfstuff_open_str.restype = ctypes.c_void_p
+    lib.csfstuff_free_table.argtypes = [ctypes.c_void_p]
+    lib.csfstuff_size.argtypes = [ctypes.c_void_p]
+    lib.csfstuff_size.restype = ctypes.c_size_t
+    lib.csfstuff_lang_code.argtypes = [ctypes.c_void_p]
+    lib.csfstuff_lang_code.restype = ctypes.c_uint32
+    lib.csfstuff_get_entry.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.POINTER(Entry)]
+    lib.csfstuff_find.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]
+    lib.csfstuff_find.restype = ctypes.c_int64
+    for encode in (lib.csfstuff_encode_csf, lib.csfstuff_encode_str):
+        encode.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t)]
+    lib.csfstuff_free.argtypes = [ctypes.c_void_p]
+    return lib
+
+
+LIB = load_library()
+
+
+def get_entry(table, i):
+    """
+    (label, str, extra_data or None) of entry i, copied out of the table.
+    """
+    e = Entry()
+    assert LIB.csfstuff_get_entry(table, i, ctypes.byref(e)) == 1
+    label = ctypes.string_at(e.label, e.label_length).decode("utf-8")
+    s = ctypes.string_at(e.str, e.str_length).decode("utf-8")
+    extra = ctypes.string_at(e.extra_data, e.extra_data_length).decode("utf-8") if e.has_extra_data else None
+    return label, s, extra
+
+
+def encode(table, fn):
+    out = ctypes.c_void_p()
+    size = ctypes.c_size_t()
+    assert fn(table, ctypes.byref(out), ctypes.byref(size)) == 1
+    try:
+        return ctypes.string_at(out, size.value)
+    finally:
+        LIB.csfstuff_free(out)
+
+
+def test_csf():
+    """
+    A CSF file opened from memory must give what csf2str gives, and encode back to the same bytes.
+    """
+    input_csf = (ORIGINAL_CWD / "samples/ra2md.csf").absolute()  # has extra data
+    data = input_csf.read_bytes()
+
+    table = LIB.csfstuff_open_csf(data, len(data))
+    assert table
+    try:
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+            ret = os.system(f'"{CSF2STR}" "{input_csf}" xxx.str')
+            assert ret == 0
+            expected_str = Path("xxx.str").read_bytes()
+            extra_data_json = Path("extra_data.json").read_bytes()
+            expected_extra_data = json.loads(extra_data_json)
+            os.chdir(ORIGINAL_CWD)
+
+        assert encode(table, LIB.csfstuff_encode_str) == expected_str
+        assert encode(table, LIB.csfstuff_encode_csf) == data
+
+        extra_data = {}
+        for i in range(LIB.csfstuff_size(table)):
+            label, _, extra = get_entry(table, i)
+            if extra:
+                extra_data[label] = extra
+        assert extra_data == expected_extra_data
+        assert LIB.csfstuff_get_entry(table, LIB.csfstuff_size(table), ctypes.byref(Entry())) == 0
+    finally:
+        LIB.csfstuff_free_table(table)
+
+    # And back from the STR text and extra data, like str2csf.
+    table = LIB.csfstuff_open_str(expected_str, len(expected_str), extra_data_json, len(extra_data_json), 0)
+    assert table
+    try:
+        assert encode(table, LIB.csfstuff_encode_csf) == data
+    finally:
+        LIB.csfstuff_free_table(table)
+
+
+def test_str_and_find():
+    """
+    A STR file opened from memory must encode like str2csf, and find labels.
+    """
+    input_str = (ORIGINAL_CWD / "samples/a.str").absolute()
+    data = input_str.read_bytes()
+
+    table = LIB.csfstuff_open_str(data, len(data), None, 0, 1)
+    assert table
+    try:
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+            ret = os.system(f'"{STR2CSF}" "{input_str}" yyy.csf')
+            assert ret == 0
+            expected_csf = Path("yyy.csf").read_bytes()
+            os.chdir(ORIGINAL_CWD)
+
+        assert encode(table, LIB.csfstuff_encode_csf) == expected_csf
+
+        for i in range(LIB.csfstuff_size(table)):
+            label, s, extra = get_entry(table, i)
+            key = label.encode("utf-8")
+            found = LIB.csfstuff_find(table, key, len(key))
+            assert get_entry(table, found)[0] == label
+            assert extra is None
+        assert LIB.csfstuff_find(table, b"NO:SUCH_LABEL", 13) == -1
+    finally:
+        LIB.csfstuff_free_table(table)
+
+
+def test_malformed_input():
+    """
+    Malformed CSF or STR data must give NULL, not assertions taking the interpreter down.
+    """
+    data = (ORIGINAL_CWD / "samples/ra2md.csf").read_bytes()
+    malformed_csfs = [
+        b"abc",
+        b"XFSC" + data[4:],  # bad magic
+        data[:4] + b"\x02\x00\x00\x00" + data[8:],  # format 2
+        data[:24] + b"XLBL" + data[28:],  # bad label header
+        data[:len(data) // 2],  # truncated label table
+    ]
+    for csf in malformed_csfs:
+        assert not LIB.csfstuff_open_csf(csf, len(csf))
+
+    malformed_strs = [
+        b'LABEL\nnot quoted\nEND\n',
+        b'LABEL\n"str"\nEND junk\n',
+        b'LABEL\n"unknown \\q escape"\nEND\n',
+        b'LABEL\n"abc\xed\xa0\x80"\nEND\n',
+    ]
+    for s in malformed_strs:
+        assert not LIB.csfstuff_open_str(s, len(s), None, 0, 1), s
+
+    s = b'LABEL\n"str"\nEND\n'
+    assert not LIB.csfstuff_open_str(s, len(s), b"{", 1, 1)
@@ -80,5 +80,62 @@ def test_extra_data_generation():
         os.chdir(ORIGINAL_CWD)
 
 
+def test_parallel_decoding():
+    """
+    -j N must produce the same STR and extra_data.json as the sequential decoder.
+    """
+    for input_csf in sorted((ORIGINAL_CWD / "samples").glob("*.csf")):
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+
+            ret = os.system(f'"{CSF2STR}" "{input_csf}" seq.str')
+            assert ret == 0
+            has_extra_data = os.path.exists('extra_data.json')
+            if has_extra_data:
+                os.rename('extra_data.json', 'seq.json')
+
+            ret = os.system(f'"{CSF2STR}" -j 4 "{input_csf}" par.str')
+            assert ret == 0
+
+            assert os.system('diff seq.str par.str') == 0
+            assert os.path.exists('extra_data.json') == has_extra_data
+            if has_extra_data:
+                assert os.system('diff seq.json extra_data.json') == 0
+
+            os.chdir(ORIGINAL_CWD)
+
+    print("Passed parallel decoding.")
+
+
+def test_streaming_decoding():
+    """
+    --stream must produce the same STR file, and extra_data.json with the same content.
+    """
+    for input_csf in sorted((ORIGINAL_CWD / "samples").glob("*.csf")):
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+
+            ret = os.system(f'"{CSF2STR}" "{input_csf}" seq.str')
+            assert ret == 0
+            has_extra_data = os.path.exists('extra_data.json')
+            if has_extra_data:
+                os.rename('extra_data.json', 'seq.json')
+
+            ret = os.system(f'"{CSF2STR}" --stream -j 2 "{input_csf}" stream.str')
+            assert ret == 0
+
+            assert os.system('diff seq.str stream.str') == 0
+            assert os.path.exists('extra_data.json') == has_extra_data
+            if has_extra_data:
+                with open('seq.json') as f:
+                    expected = json.load(f)
+                with open('extra_data.json') as f:
+                    assert json.load(f) == expected
+
+            os.chdir(ORIGINAL_CWD)
+
+    print("Passed streaming decoding.")
+
+
 if __name__ == "__main__":
     test_str_generation()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python
+"""
+After building the project, you can run python nosetests.
+Just install nosetests then run nosetest command to run the tests.
+"""
+
+import os
+import tempfile
+from pathlib import Path
+
+ORIGINAL_CWD = Path(os.getcwd())
+CSF2STR = Path("build/csf2str").absolute()
+STR2CSF = Path("build/str2csf").absolute()
+MERGE_STR = Path("build/merge_str").absolute()
+MERGE_CSF = Path("build/merge_csf").absolute()
+assert MERGE_CSF.exists(), "merge_csf is not compiled."
+
+
+def test_same_as_str_merge():
+    """
+    Merging CSF files must give the same result as converting them to STR, merging and converting back.
+    """
+    inputs = [(ORIGINAL_CWD / f"samples/{name}.str").absolute() for name in "abc"]
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        for input_str in inputs:
+            ret = os.system(f'"{STR2CSF}" "{input_str}" {input_str.stem}.csf')
+            assert ret == 0
+
+        ret = os.system(f'"{MERGE_CSF}" a.csf b.csf c.csf xxx.csf > /dev/null')
+        assert ret == 0
+
+        strs = " ".join(f'"{s}"' for s in inputs)
+        ret = os.system(f'"{MERGE_STR}" {strs} yyy.str > /dev/null')
+        assert ret == 0
+        ret = os.system(f'"{STR2CSF}" yyy.str yyy.csf')
+        assert ret == 0
+
+        ret = os.system('diff xxx.csf yyy.csf')
+        assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed a b c -> x merge")
+
+
+def test_extra_data():
+    """
+    Extra data must survive the merge, without any extra_data.json.
+    """
+    ra2md = (ORIGINAL_CWD / "samples/ra2md.csf").absolute()  # has extra data
+    input_a = (ORIGINAL_CWD / "samples/a.str").absolute()
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = os.system(f'"{STR2CSF}" "{input_a}" a.csf')
+        assert ret == 0
+        ret = os.system(f'"{MERGE_CSF}" "{ra2md}" a.csf xxx.csf > /dev/null')
+        assert ret == 0
+
+        ret = os.system(f'"{CSF2STR}" "{ra2md}" ra2md.str > /dev/null')
+        assert ret == 0
+        ret = os.system(f'"{MERGE_STR}" ra2md.str "{input_a}" yyy.str > /dev/null')
+        assert ret == 0
+        ret = os.system(f'"{STR2CSF}" yyy.str yyy.csf extra_data.json')
+        assert ret == 0
+
+        ret = os.system('diff xxx.csf yyy.csf')
+        assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed extra data merge")
+
+
+if __name__ == "__main__":
+    test_same_as_str_merge()
+    test_extra_data()
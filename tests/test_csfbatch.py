@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+"""
+After building the project, you can run python nosetests.
+Just install nosetests then run nosetest command to run the tests.
+"""
+
+import os
+import subprocess
+import tempfile
+from pathlib import Path
+
+ORIGINAL_CWD = Path(os.getcwd())
+CSF2STR = Path("build/csf2str").absolute()
+CSFBATCH = Path("build/csfbatch").absolute()
+assert CSFBATCH.exists(), "csfbatch is not compiled."
+
+SAMPLES = ["gamestrings.csf", "ra2md.csf", "mod.csf"]
+
+
+def test_round_trip():
+    """
+    A manifest converting the samples to STR, then another back to CSF,
+    must match csf2str and reconstruct the inputs, extra data included.
+    """
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        with open("to_str.txt", "w") as f:
+            f.write("# CSF -> STR\n\n")
+            for name in SAMPLES:
+                f.write(f'"{ORIGINAL_CWD / "samples" / name}" "{Path(name).stem} out.str"\n')
+        ret = subprocess.run([str(CSFBATCH), "-j", "2", "to_str.txt"], capture_output=True, encoding="utf-8")
+        assert ret.returncode == 0, ret.stderr
+        assert "Total of 3 files" in ret.stdout
+
+        for name in SAMPLES:
+            os.system(f'"{CSF2STR}" "{ORIGINAL_CWD / "samples" / name}" expected.str')
+            assert Path(f"{Path(name).stem} out.str").read_bytes() == Path("expected.str").read_bytes()
+            assert Path(f"{Path(name).stem} out.json").exists() == Path("extra_data.json").exists()
+            if Path("extra_data.json").exists():
+                assert Path(f"{Path(name).stem} out.json").read_bytes() == Path("extra_data.json").read_bytes()
+                os.remove("extra_data.json")
+
+        args = []
+        for name in SAMPLES:
+            args += [f"{Path(name).stem} out.str", name]
+        ret = subprocess.run([str(CSFBATCH), *args], capture_output=True, encoding="utf-8")
+        assert ret.returncode == 0, ret.stderr
+
+        for name in SAMPLES:
+            assert Path(name).read_bytes() == (ORIGINAL_CWD / "samples" / name).read_bytes()
+
+        os.chdir(ORIGINAL_CWD)
+
+
+def test_failed_job():
+    """
+    A missing input fails its own job only, and the exit code tells.
+    """
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = subprocess.run(
+            [str(CSFBATCH), "missing.csf", "a.str", str(ORIGINAL_CWD / "samples/mod.csf"), "b.str"],
+            capture_output=True, encoding="utf-8")
+        assert ret.returncode == 1
+        assert "missing.csf -> a.str: FAILED" in ret.stdout
+        assert Path("b.str").exists()
+
+        ret = subprocess.run([str(CSFBATCH), "a.txt", "b.str"], capture_output=True, encoding="utf-8")
+        assert ret.returncode == 2
+
+        # Unwritable outputs and malformed inputs, in both directions, next to a good job.
+        with open("bad.str", "w") as f:
+            f.write('LABEL\nnot quoted\nEND\n')
+        with open("bad.csf", "wb") as f:
+            f.write(b"XFSC" + (ORIGINAL_CWD / "samples/mod.csf").read_bytes()[4:])
+        jobs = [
+            str(ORIGINAL_CWD / "samples/mod.csf"), "no_dir/a.str",
+            "b.str", "no_dir/b.csf",
+            "bad.str", "c.csf",
+            "bad.csf", "d.str",
+            "b.str", "e.csf",
+        ]
+        ret = subprocess.run([str(CSFBATCH), "-j", "2", *jobs], capture_output=True, encoding="utf-8")
+        assert ret.returncode == 1, ret.stderr
+        assert "4 files failed" in ret.stdout
+        for i in range(0, 8, 2):
+            assert f"{jobs[i]} -> {jobs[i + 1]}: FAILED" in ret.stdout
+        assert "not a proper in-game string" in ret.stderr
+        assert Path("e.csf").exists()
+        assert not Path("c.csf").exists()
+
+        os.chdir(ORIGINAL_CWD)
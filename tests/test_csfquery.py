@@ -0,0 +1,185 @@
+#!/usr/bin/env python
+"""
+After building the project, you can run python nosetests.
+Just install nosetests then run nosetest command to run the tests.
+"""
+
+import os
+import shutil
+import subprocess
+import tempfile
+from pathlib import Path
+
+ORIGINAL_CWD = Path(os.getcwd())
+CSF2STR = Path("build/csf2str").absolute()
+CSFQUERY = Path("build/csfquery").absolute()
+assert CSFQUERY.exists(), "csfquery is not compiled."
+
+
+def read_str_entries(fname):
+    """
+    label -> list of entry texts, as csf2str writes them.
+    """
+    with open(fname, encoding="utf-8") as f:
+        blocks = f.read().split("END\n")
+    entries = {}
+    for block in blocks:
+        lines = block.strip("\n").split("\n")
+        if len(lines) == 2:
+            entries.setdefault(lines[0], []).append(f"{lines[0]}\n{lines[1]}\nEND\n")
+    return entries
+
+
+def query(*args):
+    return subprocess.run([str(CSFQUERY), *args], capture_output=True, encoding="utf-8")
+
+
+def test_get():
+    """
+    get must print the same entries as csf2str, and create the index on the way.
+    """
+    input_csf = (ORIGINAL_CWD / "samples/ra2md.csf").absolute()
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+        shutil.copy(input_csf, "x.csf")
+
+        ret = os.system(f'"{CSF2STR}" x.csf x.str > /dev/null')
+        assert ret == 0
+        entries = read_str_entries("x.str")
+
+        labels = sorted(entries)[::97]
+        result = query("x.csf", "get", *labels)
+        assert result.returncode == 0
+        assert result.stdout == "\n".join("".join(entries[label]) for label in labels)
+        assert os.path.exists("x.csfidx")
+
+        # STR files give the same answers.
+        assert query("x.str", "get", *labels).stdout == result.stdout
+
+        # Same answer from the saved index.
+        assert query("x.csf", "get", *labels).stdout == result.stdout
+
+        result = query("x.csf", "get", "NO:SUCHLABEL")
+        assert result.returncode == 1
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed csfquery get")
+
+
+def test_stale_index():
+    """
+    The index must be rebuilt when the CSF file changes under it.
+    """
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+        shutil.copy(ORIGINAL_CWD / "samples/gamestrings.csf", "x.csf")
+        assert query("x.csf", "get", "GUI:OK").returncode == 0
+
+        shutil.copy(ORIGINAL_CWD / "samples/ra2md.csf", "x.csf")
+        result = query("x.csf", "get", "VOX:aprotr1")
+        assert result.returncode == 0
+        assert result.stdout.startswith("VOX:aprotr1\n")
+
+        with open("x.csfidx", "wb") as f:
+            f.write(b"garbage")
+        assert query("x.csf", "get", "VOX:aprotr1").stdout == result.stdout
+
+        # Right size, but entries pointing out of the CSF file.
+        index = bytearray(Path("x.csfidx").read_bytes())
+        index[32:48] = b"\xff" * 16
+        Path("x.csfidx").write_bytes(index)
+        assert query("x.csf", "get", "VOX:aprotr1").stdout == result.stdout
+        assert Path("x.csfidx").read_bytes() != index
+
+        # Same size and modification time, but a label renamed in place.
+        csf = Path("x.csf").read_bytes()
+        assert csf.count(b"VOX:aprotr1") == 1
+        stat = os.stat("x.csf")
+        Path("x.csf").write_bytes(csf.replace(b"VOX:aprotr1", b"VOX:zzzzzz1"))
+        os.utime("x.csf", ns=(stat.st_atime_ns, stat.st_mtime_ns))
+        renamed = query("x.csf", "get", "VOX:zzzzzz1")
+        assert renamed.returncode == 0, renamed.stderr
+        assert renamed.stdout == result.stdout.replace("VOX:aprotr1", "VOX:zzzzzz1")
+        assert query("x.csf", "get", "VOX:aprotr1").returncode == 1
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed stale index")
+
+
+def test_unsaved_index():
+    """
+    Failing to save the index must not fail the query, nor must concurrent queries saving the same index.
+    """
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        # Too long a name for the temporary index file.
+        long_name = "x" * 240 + ".csf"
+        shutil.copy(ORIGINAL_CWD / "samples/ra2md.csf", long_name)
+        result = query(long_name, "get", "VOX:aprotr1")
+        assert result.returncode == 0, result.stderr
+        assert result.stdout.startswith("VOX:aprotr1\n")
+        assert os.listdir(".") == [long_name]
+
+        shutil.copy(ORIGINAL_CWD / "samples/ra2md.csf", "x.csf")
+        queries = [subprocess.Popen([str(CSFQUERY), "x.csf", "get", "VOX:aprotr1"],
+                                    stdout=subprocess.PIPE, stderr=subprocess.PIPE) for _ in range(8)]
+        for q in queries:
+            stdout, stderr = q.communicate()
+            assert q.returncode == 0, stderr
+            assert stdout.decode("utf-8") == result.stdout
+        assert sorted(os.listdir(".")) == sorted([long_name, "x.csf", "x.csfidx"])
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed unsaved index")
+
+
+def test_prefix_and_grep():
+    """
+    prefix lists labels in sorted order, grep in file order, for both CSF and STR files.
+    """
+    input_csf = (ORIGINAL_CWD / "samples/ra2md.csf").absolute()
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+        shutil.copy(input_csf, "x.csf")
+
+        ret = os.system(f'"{CSF2STR}" x.csf x.str > /dev/null')
+        assert ret == 0
+        entries = read_str_entries("x.str")
+
+        for prefix in ["VOX:", "GUI:", "NAME:A"]:
+            expected = "\n".join("".join(entries[label]) for label in sorted(entries) if label.startswith(prefix))
+            for fname in ["x.csf", "x.str"]:
+                result = query(fname, "prefix", prefix)
+                assert result.returncode == 0
+                assert result.stdout == expected, (fname, prefix)
+
+        assert query("x.csf", "prefix", "NO:SUCHPREFIX").returncode == 1
+
+        result = query("x.csf", "grep", "hot food")
+        assert result.returncode == 0
+        assert result.stdout.startswith("VOX:aprotr1\n")
+        assert query("x.str", "grep", "hot food").stdout == result.stdout
+
+        with open("x.str", encoding="utf-8") as f:
+            order = [line.rstrip("\n") for i, line in enumerate(f) if i % 4 == 0]
+        result = query("x.csf", "grep", "^VOX:")
+        labels = [line for i, line in enumerate(result.stdout.split("\n")) if i % 4 == 0 and line]
+        assert labels == [label for label in order if label.startswith("VOX:")]
+
+        assert query("x.csf", "grep", "(").returncode == 2
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed csfquery prefix and grep")
+
+
+if __name__ == "__main__":
+    test_get()
+    test_prefix_and_grep()
+    test_stale_index()
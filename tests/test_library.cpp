@@ -0,0 +1,53 @@
+/**
+ * Round trips through the in-memory API of the csfstuff library, without touching any file.
+ * Run by ctest.
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../include/csfstuff.hpp"
+
+using namespace std;
+
+bool check(const char *what, const string &got, const string &expected)
+{
+    bool ok = got == expected;
+    printf("%-16s %s\n", what, ok ? "OK" : "FAILED");
+    if (!ok)
+        printf("expected:\n%s\ngot:\n%s\n", expected.c_str(), got.c_str());
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+
+    const string str =
+        "CSFSTUFF:META\n\"{\\\"lang_code\\\":3,\\\"unused\\\":0}\"\nEND\n"
+        "\nGUI:Ok\n\"OK\"\nEND\n"
+        "\nGUI:Cancel\n\"Cancel\\nor not\"\nEND\n"
+        "\nNAME:Tank\n\"\xed\x83\xb1\xed\x81\xac\"\nEND\n";
+    const string extra_data_json = "{\n  \"GUI:Cancel\": \"wav1\"\n}";
+
+    const string csf = str_to_csf(str, extra_data_json);
+    CSFHeader header;
+    ok = parse_csf_header(csf, &header) && header.num_labels == 3 && header.lang_code == 3 && ok;
+
+    string decoded_extra_data;
+    const string decoded = csf_to_str(csf, &decoded_extra_data, 2);
+    ok = check("str -> csf -> str", decoded, str) && ok;
+    ok = check("extra data", decoded_extra_data, extra_data_json) && ok;
+    ok = check("csf -> str -> csf", str_to_csf(decoded, decoded_extra_data), csf) && ok;
+
+    const string overlay = "NAME:Tank\n\"Tank\"\nEND\n\nNAME:Dog\n\"Dog\"\nEND\n";
+    const string expected =
+        "CSFSTUFF:META\n\"{\\\"lang_code\\\":3,\\\"unused\\\":0}\"\nEND\n"
+        "\nGUI:Ok\n\"OK\"\nEND\n"
+        "\nGUI:Cancel\n\"Cancel\\nor not\"\nEND\n"
+        "\nNAME:Tank\n\"Tank\"\nEND\n"
+        "\nNAME:Dog\n\"Dog\"\nEND\n";
+    ok = check("merge_strs", merge_strs({str, overlay}, 2), expected) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,7 @@ Just install nosetests then run nosetest command to run the tests.
 """
 
 import os
+import subprocess
 import tempfile
 from pathlib import Path
 
@@ -69,5 +70,277 @@ def test_with_extra_data():
     print("Passed csf file creation, no extra_data case.")
 
 
+def test_parallel_parsing():
+    """
+    CSF reconstruction test, parsing the STR file on several threads.
+    """
+    input_csf = (ORIGINAL_CWD / "samples/gamestrings.csf").absolute()  # big enough to be split
+    assert input_csf.exists()
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = os.system(f'"{CSF2STR}" "{input_csf}" xxx.str')
+        assert ret == 0
+
+        ret = os.system(f'"{STR2CSF}" -j 4 xxx.str yyy.csf')
+        assert ret == 0
+
+        ret = os.system(f'diff "{input_csf}" yyy.csf')
+        assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed csf file creation, parallel parsing case.")
+
+
+def test_golden_samples():
+    """
+    STR parsing regression test, samples/*.str against CSF files made by the regex based parser.
+    """
+    for input_str in sorted((ORIGINAL_CWD / "samples").glob("*.str")):
+        golden_csf = ORIGINAL_CWD / "tests/golden" / (input_str.stem + ".csf")
+        assert golden_csf.exists(), f"No golden file for {input_str.name}"
+
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+
+            ret = os.system(f'"{STR2CSF}" "{input_str}" yyy.csf')
+            assert ret == 0
+
+            ret = os.system(f'diff "{golden_csf}" yyy.csf')
+            assert ret == 0
+
+            os.chdir(ORIGINAL_CWD)
+
+    print("Passed golden STR samples.")
+
+
+def test_malformed_str():
+    """
+    Malformed STR files must be rejected. Assumes the debug build from the Makefile.
+    """
+    malformed = [
+        'LABEL\nnot quoted\nEND\n',
+        'LABEL\n// comment\n"str"\nEND\n',
+        'LABEL\n"str"\nEND junk\n',
+        'LABEL\n"str"\nENDING\n',
+        'LABEL\n"str" junk\nEND\n',
+        'LABEL\n"\nEND\n',
+    ]
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        for content in malformed:
+            with open("xxx.str", "w") as f:
+                f.write(content)
+            ret = os.system(f'"{STR2CSF}" xxx.str yyy.csf 2> /dev/null')
+            assert ret != 0, content
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed malformed STR rejection.")
+
+
+def test_malformed_utf8():
+    """
+    Invalid UTF-8 must be reported with the line of the offending string.
+    """
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        with open("xxx.str", "wb") as f:
+            f.write(b'GOOD\n"ok"\nEND\n\nBAD\n"abc\xed\xa0\x80"\nEND\n')
+        ret = os.system(f'"{STR2CSF}" xxx.str yyy.csf 2> err.txt')
+        assert ret != 0
+
+        with open("err.txt") as f:
+            err = f.read()
+        assert "line 6" in err, err
+        assert "byte 3" in err, err
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed malformed UTF-8 rejection.")
+
+
+def test_streaming():
+    """
+    --stream must write the same CSF files, and reject the same malformed input.
+    """
+    for input_csf in sorted((ORIGINAL_CWD / "samples").glob("*.csf")):
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+
+            ret = os.system(f'"{CSF2STR}" "{input_csf}" xxx.str')
+            assert ret == 0
+            extra = "extra_data.json" if os.path.exists("extra_data.json") else ""
+
+            ret = os.system(f'"{STR2CSF}" --stream xxx.str yyy.csf {extra}')
+            assert ret == 0
+
+            ret = os.system(f'diff "{input_csf}" yyy.csf')
+            assert ret == 0
+            assert not os.path.exists("yyy.csf.tmp")
+
+            os.chdir(ORIGINAL_CWD)
+
+    for input_str in sorted((ORIGINAL_CWD / "samples").glob("*.str")):
+        golden_csf = ORIGINAL_CWD / "tests/golden" / (input_str.stem + ".csf")
+        with tempfile.TemporaryDirectory() as tmpd:
+            os.chdir(tmpd)
+
+            ret = os.system(f'"{STR2CSF}" --stream "{input_str}" yyy.csf')
+            assert ret == 0
+
+            ret = os.system(f'diff "{golden_csf}" yyy.csf')
+            assert ret == 0
+
+            os.chdir(ORIGINAL_CWD)
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        with open("xxx.str", "w") as f:
+            f.write('LABEL\n"str"\nEND junk\n')
+        ret = os.system(f'"{STR2CSF}" --stream xxx.str yyy.csf 2> /dev/null')
+        assert ret != 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed streaming conversion.")
+
+
 if __name__ == "__main__":
     test_no_extra_data()
+
+
+def test_pipeline_blocks():
+    """
+    A STR file of several read blocks, with entries cut at block ends,
+    must convert the same on any number of threads as in one go.
+    """
+    bench = Path("build/csfstuff_bench").absolute()
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = os.system(f'"{bench}" --entries 50000 --extra 0.05 --rounds 1 --write gen > /dev/null')
+        assert ret == 0
+        assert os.path.getsize("gen.str") > 3 * 1024 * 1024
+
+        for threads in [1, 3]:
+            ret = os.system(f'"{STR2CSF}" -j {threads} gen.str yyy.csf gen.json')
+            assert ret == 0
+            ret = os.system('diff gen.csf yyy.csf')
+            assert ret == 0
+            assert not os.path.exists("yyy.csf.tmp")
+
+        # Cut past the first block, in the middle of a string: the last block has the error.
+        text = Path("gen.str").read_bytes()
+        cut = text.index(b'\n"', 2 * 1024 * 1024) + 5
+        Path("cut.str").write_bytes(text[:cut])
+        for threads in [1, 3]:
+            ret = os.system(f'"{STR2CSF}" -j {threads} cut.str cut.csf 2> err.txt')
+            assert ret != 0
+            assert "not a proper in-game string" in Path("err.txt").read_text()
+            assert not os.path.exists("cut.csf")
+            assert not os.path.exists("cut.csf.tmp")
+
+        os.chdir(ORIGINAL_CWD)
+
+
+def test_cache():
+    """
+    --cache must write the same CSF files whether the cache has the STR file or not,
+    use the cache when it has it, and parse again when the cache file is damaged.
+    """
+    input_str = (ORIGINAL_CWD / "samples/a.str").absolute()
+    golden_csf = ORIGINAL_CWD / "tests/golden/a.csf"
+    bench = Path("build/csfstuff_bench").absolute()
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        for _ in range(2):
+            ret = os.system(f'"{STR2CSF}" --cache cache "{input_str}" yyy.csf')
+            assert ret == 0
+            ret = os.system(f'diff "{golden_csf}" yyy.csf')
+            assert ret == 0
+        cache_files = list(Path("cache").glob("*.strcache"))
+        assert len(cache_files) == 1
+        cache = cache_files[0].read_bytes()
+
+        # The CSF file is kept too. A hit leaves a cache file alone, a miss saves it again under a new inode.
+        output_files = list(Path("cache").glob("*.out"))
+        assert len(output_files) == 1
+        output = output_files[0].read_bytes()
+        inodes = [cache_files[0].stat().st_ino, output_files[0].stat().st_ino]
+        ret = os.system(f'"{STR2CSF}" --cache cache "{input_str}" yyy.csf')
+        assert ret == 0
+        assert [cache_files[0].stat().st_ino, output_files[0].stat().st_ino] == inodes
+
+        # A damaged CSF file in the cache is made again, from the cached entries.
+        damaged = bytearray(output)
+        damaged[-1] ^= 1
+        output_files[0].write_bytes(damaged)
+        ret = os.system(f'"{STR2CSF}" --cache cache "{input_str}" yyy.csf')
+        assert ret == 0
+        ret = os.system(f'diff "{golden_csf}" yyy.csf')
+        assert ret == 0
+        assert output_files[0].read_bytes() == output
+        assert cache_files[0].stat().st_ino == inodes[0]
+
+        # Other extra data makes another CSF file from the same entries.
+        Path("extra.json").write_text('{"TYPE:JAPANBASEDEFENSEEGG": "extra"}')
+        ret = os.system(f'"{STR2CSF}" --cache cache "{input_str}" yyy.csf extra.json')
+        assert ret == 0
+        ret = os.system(f'"{STR2CSF}" "{input_str}" zzz.csf extra.json')
+        assert ret == 0
+        ret = os.system('diff yyy.csf zzz.csf')
+        assert ret == 0
+        assert Path("yyy.csf").read_bytes() != golden_csf.read_bytes()
+        assert len(list(Path("cache").glob("*.out"))) == 2
+        assert cache_files[0].stat().st_ino == inodes[0]
+        for f in Path("cache").glob("*.out"):
+            f.unlink()
+
+        # A damaged cache file is parsed over and replaced. A count of 2^59 + n entries
+        # times their 32 bytes wraps around to the right size, if multiplied unchecked.
+        # An offset one byte off still lies within the STR file, only the checksum catches it.
+        num_entries = int.from_bytes(cache[24:32], "little")
+        off_by_one = bytearray(cache)
+        off_by_one[40] ^= 1
+        for damaged in [cache[:-7], cache[:24] + (num_entries + 2**59).to_bytes(8, "little") + cache[32:], bytes(off_by_one)]:
+            cache_files[0].write_bytes(damaged)
+            ret = os.system(f'"{STR2CSF}" --cache cache "{input_str}" yyy.csf')
+            assert ret == 0
+            ret = os.system(f'diff "{golden_csf}" yyy.csf')
+            assert ret == 0
+            assert cache_files[0].read_bytes() == cache
+            # Otherwise the next run wouldn't read the entries.
+            output_files[0].unlink()
+
+        # A changed STR file gets a cache file of its own.
+        with open("xxx.str", "wb") as f:
+            f.write(input_str.read_bytes() + b'\nNEW:LABEL\n"new"\nEND\n')
+        ret = os.system(f'"{STR2CSF}" --cache cache xxx.str yyy.csf')
+        assert ret == 0
+        assert len(list(Path("cache").glob("*.strcache"))) == 2
+        ret = os.system(f'"{STR2CSF}" xxx.str zzz.csf')
+        assert ret == 0
+        ret = os.system('diff yyy.csf zzz.csf')
+        assert ret == 0
+
+        # Concurrent conversions share a cold cache, none failing for it.
+        # The file is big enough for their cache writes to overlap.
+        ret = os.system(f'"{bench}" --entries 50000 --rounds 1 --write gen > /dev/null')
+        assert ret == 0
+        convs = [subprocess.Popen([str(STR2CSF), "--cache", "cold", "gen.str", f"{i}.csf", "gen.json"], stderr=subprocess.PIPE)
+                 for i in range(8)]
+        for i, conv in enumerate(convs):
+            _, stderr = conv.communicate()
+            assert conv.returncode == 0, stderr
+            assert Path(f"{i}.csf").read_bytes() == Path("gen.csf").read_bytes()
+        assert len(os.listdir("cold")) == 2
+
+        os.chdir(ORIGINAL_CWD)
@@ -5,6 +5,7 @@ Just install nosetests then run nosetest command to run the tests.
 """
 
 import os
+import shutil
 import tempfile
 from pathlib import Path
 
@@ -107,5 +108,127 @@ def test_3merge():
     print("Passed a b c -> x merge")
 
 
+def test_duplicate_labels():
+    """
+    Duplicate labels within one input file must be rejected. Assumes the debug build from the Makefile.
+    """
+    input_a = (ORIGINAL_CWD / "samples/a.str").absolute()
+    assert input_a.exists()
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        with open("dup.str", "w") as f:
+            f.write('NAME:DUP\n"first"\nEND\n\nNAME:DUP\n"second"\nEND\n')
+        with open("ok.str", "w") as f:
+            f.write('NAME:DUP\n"first"\nEND\n')
+
+        ret = os.system(f'"{MERGE_STR}" "{input_a}" dup.str xxx.str > /dev/null 2>&1')
+        assert ret != 0
+        ret = os.system(f'"{MERGE_STR}" dup.str "{input_a}" xxx.str > /dev/null 2>&1')
+        assert ret != 0
+        ret = os.system(f'"{MERGE_STR}" ok.str ok.str xxx.str > /dev/null 2>&1')
+        assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed duplicate label check")
+
+
+def test_streaming_merge():
+    """
+    --stream must give the same output as the in-memory merge.
+    """
+    inputs = [(ORIGINAL_CWD / f"samples/{name}.str").absolute() for name in "abc"]
+    orders = [inputs, inputs[::-1], [inputs[1], inputs[0]]]
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        for order in orders:
+            names = " ".join(f'"{s}"' for s in order)
+            ret = os.system(f'"{MERGE_STR}" {names} xxx.str > /dev/null')
+            assert ret == 0
+            ret = os.system(f'"{MERGE_STR}" --stream {names} yyy.str > /dev/null')
+            assert ret == 0
+
+            ret = os.system('diff xxx.str yyy.str')
+            assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed streaming merge")
+
+
+def test_parallel_merge():
+    """
+    Parsing the inputs concurrently with -j must not change the output.
+    """
+    inputs = [(ORIGINAL_CWD / f"samples/{name}.str").absolute() for name in "abc"]
+    names = " ".join(f'"{s}"' for s in inputs)
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = os.system(f'"{MERGE_STR}" {names} xxx.str > /dev/null')
+        assert ret == 0
+        ret = os.system(f'"{MERGE_STR}" -j 3 {names} yyy.str > /dev/null')
+        assert ret == 0
+
+        ret = os.system('diff xxx.str yyy.str')
+        assert ret == 0
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed parallel merge")
+
+
+def test_cached_merge():
+    """
+    --cache must not change the output, whether the cache has the inputs or not.
+    """
+    inputs = [(ORIGINAL_CWD / f"samples/{name}.str").absolute() for name in "abc"]
+    names = " ".join(f'"{s}"' for s in inputs)
+
+    with tempfile.TemporaryDirectory() as tmpd:
+        os.chdir(tmpd)
+
+        ret = os.system(f'"{MERGE_STR}" {names} xxx.str > /dev/null')
+        assert ret == 0
+        for threads in [1, 3]:
+            ret = os.system(f'"{MERGE_STR}" -j {threads} --cache cache {names} yyy.str > /dev/null')
+            assert ret == 0
+            ret = os.system('diff xxx.str yyy.str')
+            assert ret == 0
+        assert len(list(Path("cache").glob("*.strcache"))) == len(inputs)
+        assert len(list(Path("cache").glob("*.out"))) == 1
+
+        # Inputs in another order are another output.
+        reversed_names = " ".join(f'"{s}"' for s in inputs[::-1])
+        ret = os.system(f'"{MERGE_STR}" {reversed_names} xxx2.str > /dev/null')
+        assert ret == 0
+        ret = os.system(f'"{MERGE_STR}" --cache cache {reversed_names} yyy.str > /dev/null')
+        assert ret == 0
+        ret = os.system('diff xxx2.str yyy.str')
+        assert ret == 0
+        assert len(list(Path("cache").glob("*.out"))) == 2
+
+        # The same contents twice save the same cache file from two threads at once.
+        twice = " ".join(f'"{s}"' for s in [inputs[0], inputs[0]])
+        ret = os.system(f'"{MERGE_STR}" {twice} xxx.str > /dev/null')
+        assert ret == 0
+        for _ in range(5):
+            shutil.rmtree("cache2", ignore_errors=True)
+            ret = os.system(f'"{MERGE_STR}" -j 2 --cache cache2 {twice} yyy.str > /dev/null')
+            assert ret == 0
+            ret = os.system('diff xxx.str yyy.str')
+            assert ret == 0
+            assert len(os.listdir("cache2")) == 2
+
+        os.chdir(ORIGINAL_CWD)
+
+    print("Passed cached merge")
+
+
 if __name__ == "__main__":
     test_2merge_ab()
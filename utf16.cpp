@@ -0,0 +1,589 @@
+#include <cstdint>
+#include <cstring>
+
+#include "include/utf16.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define HAVE_X86_SIMD
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define TARGET(isa)
+#   else
+#       define TARGET(isa) __attribute__((target(isa)))
+#   endif
+#endif
+
+using namespace std;
+
+#ifdef HAVE_X86_SIMD
+
+#ifdef _MSC_VER
+void cpuid(int info[4], int leaf)
+{
+    __cpuidex(info, leaf, 0);
+}
+
+uint64_t read_xcr0()
+{
+    return _xgetbv(0);
+}
+#else
+#include <cpuid.h>
+
+void cpuid(int info[4], int leaf)
+{
+    unsigned int a, b, c, d;
+    __cpuid_count(leaf, 0, a, b, c, d);
+    info[0] = a;
+    info[1] = b;
+    info[2] = c;
+    info[3] = d;
+}
+
+uint64_t read_xcr0()
+{
+    unsigned int lo, hi;
+    __asm__ volatile ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    return ((uint64_t) hi << 32) | lo;
+}
+#endif
+
+SimdLevel detect_simd_level()
+{
+    int info[4];
+    cpuid(info, 0);
+    const int max_leaf = info[0];
+
+    cpuid(info, 1);
+    const bool has_sse41 = (info[2] & (1 << 19)) != 0;
+    const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    const bool has_avx = (info[2] & (1 << 28)) != 0;
+    if (!has_sse41)
+        return SimdLevel::SCALAR;
+
+    // AVX2 also needs the OS to save the YMM registers.
+    if (max_leaf >= 7 && has_osxsave && has_avx && (read_xcr0() & 6) == 6)
+    {
+        cpuid(info, 7);
+        if ((info[1] & (1 << 5)) != 0)
+            return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE41;
+}
+
+#else
+
+SimdLevel detect_simd_level()
+{
+    return SimdLevel::SCALAR;
+}
+
+#endif
+
+const char *simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SCALAR:
+            return "scalar";
+        case SimdLevel::SSE41:
+            return "sse4.1";
+        case SimdLevel::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+/**
+ * Read code unit i and undo the bit flip.
+ */
+inline uint16_t load_flipped(const unsigned char *src, size_t i)
+{
+    return (uint16_t) ~(src[2 * i] | (src[2 * i + 1] << 8));
+}
+
+/**
+ * Decode the code point at src[i] (one or two code units) into out.
+ * Returns the number of code units consumed.
+ */
+inline size_t decode_one(const unsigned char *src, size_t i, size_t n, char **out)
+{
+    const uint32_t u = load_flipped(src, i);
+    unsigned char *o = (unsigned char *) *out;
+    size_t consumed = 1;
+    uint32_t cp = u;
+
+    if (u >= 0xD800 && u <= 0xDFFF)
+    {
+        cp = 0xFFFD;
+        if (u <= 0xDBFF && i + 1 < n)
+        {
+            const uint32_t low = load_flipped(src, i + 1);
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                cp = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+                consumed = 2;
+            }
+        }
+    }
+
+    if (cp < 0x80)
+    {
+        *o++ = cp;
+    }
+    else if (cp < 0x800)
+    {
+        *o++ = 0xC0 | (cp >> 6);
+        *o++ = 0x80 | (cp & 0x3F);
+    }
+    else if (cp < 0x10000)
+    {
+        *o++ = 0xE0 | (cp >> 12);
+        *o++ = 0x80 | ((cp >> 6) & 0x3F);
+        *o++ = 0x80 | (cp & 0x3F);
+    }
+    else
+    {
+        *o++ = 0xF0 | (cp >> 18);
+        *o++ = 0x80 | ((cp >> 12) & 0x3F);
+        *o++ = 0x80 | ((cp >> 6) & 0x3F);
+        *o++ = 0x80 | (cp & 0x3F);
+    }
+
+    *out = (char *) o;
+    return consumed;
+}
+
+/**
+ * Decode code units from i until at least block units are consumed,
+ * or the input ends. A surrogate pair may make it one more.
+ */
+inline size_t decode_block_scalar(const unsigned char *src, size_t i, size_t n, size_t block, char **out)
+{
+    const size_t end = (i + block < n) ? i + block : n;
+    while (i < end)
+        i += decode_one(src, i, n, out);
+    return i;
+}
+
+/**
+ * 4 code units at a time through a 64 bit word, starting from code unit i.
+ * Also finishes the tails the SIMD kernels leave behind.
+ */
+char *decode_scalar(const unsigned char *src, size_t i, size_t n, char *out)
+{
+    const uint64_t non_ascii = 0xFF80FF80FF80FF80ull;
+    while (i + 4 <= n)
+    {
+        uint64_t word;
+        memcpy(&word, src + 2 * i, 8);
+        word = ~word;
+        if ((word & non_ascii) == 0)
+        {
+            out[0] = (char) word;
+            out[1] = (char) (word >> 16);
+            out[2] = (char) (word >> 32);
+            out[3] = (char) (word >> 48);
+            out += 4;
+            i += 4;
+        }
+        else
+        {
+            i = decode_block_scalar(src, i, n, 4, &out);
+        }
+    }
+    while (i < n)
+        i += decode_one(src, i, n, &out);
+
+    return out;
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * 16 code units at a time. All-ASCII blocks are narrowed with packus,
+ * the others go through the scalar decoder.
+ */
+TARGET("sse4.1") char *decode_sse41(const unsigned char *src, size_t n, char *out)
+{
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i non_ascii = _mm_set1_epi16((short) 0xFF80);
+    size_t i = 0;
+    while (i + 16 <= n)
+    {
+        __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (src + 2 * i)), ones);
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (src + 2 * i + 16)), ones);
+        if (_mm_test_all_zeros(_mm_or_si128(a, b), non_ascii))
+        {
+            _mm_storeu_si128((__m128i *) out, _mm_packus_epi16(a, b));
+            out += 16;
+            i += 16;
+        }
+        else
+        {
+            i = decode_block_scalar(src, i, n, 16, &out);
+        }
+    }
+
+    return decode_scalar(src, i, n, out);
+}
+
+/**
+ * 32 code units at a time, then one 16 unit step with 128 bit registers,
+ * same idea as the SSE4.1 version.
+ */
+TARGET("avx2") char *decode_avx2(const unsigned char *src, size_t n, char *out)
+{
+    const __m256i ones = _mm256_set1_epi16(-1);
+    const __m256i non_ascii = _mm256_set1_epi16((short) 0xFF80);
+    size_t i = 0;
+    while (i + 32 <= n)
+    {
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (src + 2 * i)), ones);
+        __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (src + 2 * i + 32)), ones);
+        if (_mm256_testz_si256(_mm256_or_si256(a, b), non_ascii))
+        {
+            // packus works within 128 bit lanes, put the quadwords back in order.
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256((__m256i *) out, packed);
+            out += 32;
+            i += 32;
+        }
+        else
+        {
+            i = decode_block_scalar(src, i, n, 32, &out);
+        }
+    }
+
+    // Leaving the upper halves dirty makes the SSE code after us crawl on some CPUs.
+    _mm256_zeroupper();
+
+    if (i + 16 <= n)
+    {
+        __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (src + 2 * i)), _mm_set1_epi16(-1));
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (src + 2 * i + 16)), _mm_set1_epi16(-1));
+        if (_mm_test_all_zeros(_mm_or_si128(a, b), _mm_set1_epi16((short) 0xFF80)))
+        {
+            _mm_storeu_si128((__m128i *) out, _mm_packus_epi16(a, b));
+            out += 16;
+            i += 16;
+        }
+    }
+
+    return decode_scalar(src, i, n, out);
+}
+
+#endif
+
+size_t flipped_utf16_to_utf8(const char *p, size_t n, char *out, SimdLevel level)
+{
+    const unsigned char *src = (const unsigned char *) p;
+    char *out_end;
+
+    switch (level)
+    {
+#ifdef HAVE_X86_SIMD
+        case SimdLevel::AVX2:
+            out_end = decode_avx2(src, n, out);
+            break;
+        case SimdLevel::SSE41:
+            out_end = decode_sse41(src, n, out);
+            break;
+#endif
+        default:
+            out_end = decode_scalar(src, 0, n, out);
+            break;
+    }
+
+    return out_end - out;
+}
+
+size_t flipped_utf16_to_utf8(const char *p, size_t n, char *out)
+{
+    static const SimdLevel level = detect_simd_level();
+    return flipped_utf16_to_utf8(p, n, out, level);
+}
+
+string flipped_utf16_to_utf8(const char *p, size_t n, SimdLevel level)
+{
+    string result(3 * n, '\0');
+    result.resize(flipped_utf16_to_utf8(p, n, &result[0], level));
+    return result;
+}
+
+string flipped_utf16_to_utf8(const char *p, size_t n)
+{
+    static const SimdLevel level = detect_simd_level();
+    return flipped_utf16_to_utf8(p, n, level);
+}
+
+/**
+ * Decode the UTF-8 sequence at s[i] into *cp.
+ * Returns the number of bytes consumed, or 0 if the sequence is malformed.
+ * Overlong forms, surrogates and code points beyond U+10FFFF are malformed too.
+ */
+inline size_t decode_utf8(const unsigned char *s, size_t i, size_t len, uint32_t *cp)
+{
+    const uint32_t b0 = s[i];
+    if (b0 < 0x80)
+    {
+        *cp = b0;
+        return 1;
+    }
+
+    size_t n;
+    uint32_t lo = 0x80, hi = 0xBF; // valid range of the second byte
+    if (b0 >= 0xC2 && b0 <= 0xDF)
+    {
+        n = 2;
+        *cp = b0 & 0x1F;
+    }
+    else if (b0 >= 0xE0 && b0 <= 0xEF)
+    {
+        n = 3;
+        *cp = b0 & 0x0F;
+        if (b0 == 0xE0)
+            lo = 0xA0;
+        else if (b0 == 0xED)
+            hi = 0x9F;
+    }
+    else if (b0 >= 0xF0 && b0 <= 0xF4)
+    {
+        n = 4;
+        *cp = b0 & 0x07;
+        if (b0 == 0xF0)
+            lo = 0x90;
+        else if (b0 == 0xF4)
+            hi = 0x8F;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (len - i < n)
+        return 0;
+    if (s[i + 1] < lo || s[i + 1] > hi)
+        return 0;
+    *cp = (*cp << 6) | (s[i + 1] & 0x3F);
+    for (size_t k = 2 ; k < n ; k++)
+    {
+        if ((s[i + k] & 0xC0) != 0x80)
+            return 0;
+        *cp = (*cp << 6) | (s[i + k] & 0x3F);
+    }
+    return n;
+}
+
+inline void store_flipped(unsigned char *out, uint16_t u)
+{
+    u = ~u;
+    out[0] = u & 0xFF;
+    out[1] = u >> 8;
+}
+
+/**
+ * Encode the code point at s[i] into out as one or two flipped code units.
+ * A malformed sequence eats one byte and becomes U+FFFD.
+ * Returns the number of bytes consumed.
+ */
+inline size_t encode_one(const unsigned char *s, size_t i, size_t len, unsigned char **out, size_t *error_offset)
+{
+    uint32_t cp;
+    size_t n = decode_utf8(s, i, len, &cp);
+    if (n == 0)
+    {
+        if (*error_offset == string_view::npos)
+            *error_offset = i;
+        cp = 0xFFFD;
+        n = 1;
+    }
+
+    if (cp < 0x10000)
+    {
+        store_flipped(*out, cp);
+        *out += 2;
+    }
+    else
+    {
+        cp -= 0x10000;
+        store_flipped(*out, 0xD800 + (cp >> 10));
+        store_flipped(*out + 2, 0xDC00 + (cp & 0x3FF));
+        *out += 4;
+    }
+    return n;
+}
+
+/**
+ * Encode from byte i until at least block bytes are consumed, or the input ends.
+ */
+inline size_t encode_block_scalar(const unsigned char *s, size_t i, size_t len, size_t block, unsigned char **out, size_t *error_offset)
+{
+    const size_t end = (i + block < len) ? i + block : len;
+    while (i < end)
+        i += encode_one(s, i, len, out, error_offset);
+    return i;
+}
+
+/**
+ * 8 bytes at a time through a 64 bit word, starting from byte i.
+ * Also finishes the tails the SIMD kernels leave behind.
+ */
+unsigned char *encode_scalar(const unsigned char *s, size_t i, size_t len, unsigned char *out, size_t *error_offset)
+{
+    while (i + 8 <= len)
+    {
+        uint64_t word;
+        memcpy(&word, s + i, 8);
+        if ((word & 0x8080808080808080ull) == 0)
+        {
+            for (int k = 0 ; k < 8 ; k++)
+            {
+                out[2 * k] = ~(unsigned char) (word >> (8 * k));
+                out[2 * k + 1] = 0xFF;
+            }
+            out += 16;
+            i += 8;
+        }
+        else
+        {
+            i = encode_block_scalar(s, i, len, 8, &out, error_offset);
+        }
+    }
+    while (i < len)
+        i += encode_one(s, i, len, &out, error_offset);
+
+    return out;
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * 16 bytes at a time. All-ASCII blocks are widened with pmovzxbw and flipped,
+ * the others go through the scalar encoder.
+ */
+TARGET("sse4.1") unsigned char *encode_sse41(const unsigned char *s, size_t len, unsigned char *out, size_t *error_offset)
+{
+    const __m128i ones = _mm_set1_epi16(-1);
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        if (_mm_movemask_epi8(v) == 0)
+        {
+            __m128i lo = _mm_xor_si128(_mm_cvtepu8_epi16(v), ones);
+            __m128i hi = _mm_xor_si128(_mm_cvtepu8_epi16(_mm_srli_si128(v, 8)), ones);
+            _mm_storeu_si128((__m128i *) out, lo);
+            _mm_storeu_si128((__m128i *) (out + 16), hi);
+            out += 32;
+            i += 16;
+        }
+        else
+        {
+            i = encode_block_scalar(s, i, len, 16, &out, error_offset);
+        }
+    }
+
+    return encode_scalar(s, i, len, out, error_offset);
+}
+
+/**
+ * 32 bytes at a time, same idea as the SSE4.1 version.
+ */
+TARGET("avx2") unsigned char *encode_avx2(const unsigned char *s, size_t len, unsigned char *out, size_t *error_offset)
+{
+    const __m256i ones = _mm256_set1_epi16(-1);
+    size_t i = 0;
+    while (i + 32 <= len)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        if (_mm256_movemask_epi8(v) == 0)
+        {
+            __m256i lo = _mm256_xor_si256(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)), ones);
+            __m256i hi = _mm256_xor_si256(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)), ones);
+            _mm256_storeu_si256((__m256i *) out, lo);
+            _mm256_storeu_si256((__m256i *) (out + 32), hi);
+            out += 64;
+            i += 32;
+        }
+        else
+        {
+            i = encode_block_scalar(s, i, len, 32, &out, error_offset);
+        }
+    }
+
+    // See decode_avx2()
+    _mm256_zeroupper();
+
+    return encode_scalar(s, i, len, out, error_offset);
+}
+
+#endif
+
+size_t utf16_length(string_view s)
+{
+    const unsigned char *p = (const unsigned char *) s.data();
+    const size_t len = s.length();
+    size_t units = 0;
+    size_t i = 0;
+    while (i < len)
+    {
+        if (i + 8 <= len)
+        {
+            uint64_t word;
+            memcpy(&word, p + i, 8);
+            if ((word & 0x8080808080808080ull) == 0)
+            {
+                units += 8;
+                i += 8;
+                continue;
+            }
+        }
+
+        uint32_t cp;
+        size_t n = decode_utf8(p, i, len, &cp);
+        if (n == 0)
+        {
+            units += 1;
+            i += 1;
+        }
+        else
+        {
+            units += (cp < 0x10000) ? 1 : 2;
+            i += n;
+        }
+    }
+    return units;
+}
+
+size_t utf8_to_flipped_utf16(string_view s, char *out, size_t *error_offset, SimdLevel level)
+{
+    const unsigned char *src = (const unsigned char *) s.data();
+    unsigned char *dst = (unsigned char *) out;
+    unsigned char *dst_end;
+    *error_offset = string_view::npos;
+
+    switch (level)
+    {
+#ifdef HAVE_X86_SIMD
+        case SimdLevel::AVX2:
+            dst_end = encode_avx2(src, s.length(), dst, error_offset);
+            break;
+        case SimdLevel::SSE41:
+            dst_end = encode_sse41(src, s.length(), dst, error_offset);
+            break;
+#endif
+        default:
+            dst_end = encode_scalar(src, 0, s.length(), dst, error_offset);
+            break;
+    }
+
+    return (dst_end - dst) / 2;
+}
+
+size_t utf8_to_flipped_utf16(string_view s, char *out, size_t *error_offset)
+{
+    static const SimdLevel level = detect_simd_level();
+    return utf8_to_flipped_utf16(s, out, error_offset, level);
+}